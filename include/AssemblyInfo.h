@@ -11,6 +11,7 @@ struct AssemblyInfo {
         STRING,
         BOOL,
         NULL_T,
+        OBJECT,
         VARS,
         VARD,
         VARB
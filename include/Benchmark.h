@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* jj --bench: compiles generated corpora of growing size in-process and reports the throughput of each phase
+ * (tokens/s for scanning, AST nodes/s for parsing and resolution, assembly bytes/s for codegen and linking).
+ * Phases whose time grows clearly faster than the input are flagged as super-linear. */
+class Benchmark {
+public:
+    /* Returns non-zero if any phase scaled super-linearly */
+    static int run(const std::vector<std::string>& shapes, size_t maxBytes, std::ostream& out);
+
+    /* "64K", "500M", "1G" or a plain byte count; 0 if it is not a size */
+    static size_t parseSize(const std::string& text);
+};
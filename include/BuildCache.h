@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/* On-disk store of build products, addressed by a hash of every input that produced them */
+class BuildCache {
+public:
+    /* Incremental 64-bit FNV-1a hash; each part is length-prefixed so ("ab", "c") and ("a", "bc") differ */
+    class Key {
+    public:
+        Key& add(std::string_view data);
+        Key& addFile(const std::filesystem::path& file);
+
+        [[nodiscard]] std::string str() const;
+
+    private:
+        uint64_t hash = 14695981039346656037ULL;
+
+        void mix(std::string_view bytes);
+    };
+
+    explicit BuildCache(std::filesystem::path directory);
+
+    /* $JAY_CACHE_DIR, else $XDG_CACHE_HOME/jaylang, else ~/.cache/jaylang */
+    static std::filesystem::path defaultDirectory();
+
+    /* Copies the entry for key to destination; false if there is none */
+    bool fetch(const std::string& key, const std::filesystem::path& destination) const;
+
+    /* Failing to write the cache is not an error; the build just is not reused */
+    bool store(const std::string& key, const std::filesystem::path& source) const;
+
+private:
+    std::filesystem::path directory;
+
+    [[nodiscard]] std::filesystem::path entry(const std::string& key) const;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+/* Register machine instructions for --interp. Operands a, b and c are registers unless noted; jump targets are
+ * instruction indices within the module's chunk. */
+enum class Op : uint8_t {
+    /* a = constants[b] */
+    LOADK,
+    /* a = b */
+    MOVE,
+    /* a = globals[b] */
+    GETGLOBAL,
+    /* globals[a] = b */
+    SETGLOBAL,
+    /* a = b op c */
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    /* a = op b */
+    NEG,
+    NOT,
+    /* Go to a */
+    JUMP,
+    /* Go to b if a is truthy, or falsy */
+    JUMPIF,
+    JUMPIFNOT,
+    /* Go to c if a compares to b so */
+    JUMPEQ,
+    JUMPNE,
+    JUMPLT,
+    JUMPLE,
+    JUMPGT,
+    JUMPGE,
+    /* Print a and a newline */
+    LOG,
+    /* Write out everything logged so far */
+    FLUSH,
+    /* a = builtin b applied to registers c, c + 1, ... */
+    CALL,
+    /* Run module a's top level, the first time only */
+    IMPORT,
+    RETURN,
+    COUNT
+};
+
+/* The JavaStaticCall targets --interp runs itself, with the results JayInterop gives on the JVM: numbers are passed
+ * as doubles and double results come back through Double.toString. Each takes a fixed number of arguments. */
+enum class Builtin : uint8_t {
+    /* java.lang.Math and java.lang.StrictMath, which agree on these */
+    ABS,
+    MAX,
+    MIN,
+    SQRT,
+    FLOOR,
+    CEIL,
+    RINT,
+    SIGNUM,
+    /* java.lang.Math only */
+    TO_RADIANS,
+    TO_DEGREES,
+    /* java.lang.String instance methods, called with the string first */
+    CONCAT,
+    LENGTH
+};
+
+struct Instruction {
+    Op op;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+};
+
+/* A literal; strings without their quotes and with escapes decoded */
+using Constant = std::variant<double, std::string, bool, std::nullptr_t>;
+
+/* One module's top level */
+struct Chunk {
+    std::string name;
+    std::vector<Instruction> code {};
+    /* Source line of each instruction, counted from one */
+    std::vector<int> lines {};
+    std::vector<Constant> constants {};
+    uint32_t registers = 0;
+};
+
+/* Every module of a script, sharing one table of module globals */
+struct BytecodeProgram {
+    std::vector<Chunk> modules;
+    std::unordered_map<std::string, uint32_t> moduleIndex;
+    /* "module.name" of each global, by index */
+    std::vector<std::string> globals;
+    std::unordered_map<std::string, uint32_t> globalIndex;
+};
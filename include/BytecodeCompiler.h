@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Expression.h"
+#include "Statement.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Lowers resolved modules to register bytecode for the interpreter. A module's locals keep the slot numbers the
+ * Resolver gave them as their registers; temporaries are allocated above them and released after each statement. */
+class BytecodeCompiler {
+public:
+    explicit BytecodeCompiler(BytecodeProgram& program)
+        : program { program } {};
+
+    /* Returns the module's chunk index; locals is the Resolver's maxLocals */
+    uint32_t compile(const std::string& module, const std::vector<std::shared_ptr<Statement>>& statements, size_t locals);
+
+private:
+    template <class... Ts>
+    struct overloaded : Ts... {
+        using Ts::operator()...;
+    };
+    template <class... Ts>
+    overloaded(Ts...) -> overloaded<Ts...>;
+
+    static constexpr uint32_t anywhere = UINT32_MAX;
+
+    BytecodeProgram& program;
+    uint32_t chunk = 0;
+    uint32_t locals = 0;
+    uint32_t top = 0;
+    int line = 0;
+
+    /* Loop-invariant expressions already computed into a register before the loop */
+    std::unordered_map<const Expr*, uint32_t> hoisted;
+
+    Chunk& current() { return program.modules[chunk]; }
+    uint32_t moduleIndex(const std::string& module);
+    uint32_t globalIndex(const std::string& module, const std::string& name);
+    uint32_t constant(Constant value);
+    uint32_t temporary();
+
+    size_t emit(Op op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    /* Points the jumps at target, by default the next instruction */
+    void patch(const std::vector<size_t>& jumps);
+    void patch(const std::vector<size_t>& jumps, uint32_t target);
+    /* Attributes the following instructions to a source line, unless it is unknown (-1) */
+    void at(int sourceLine);
+
+    void statement(const Statement& stmt);
+    /* Returns the register holding the value: target if given, otherwise possibly a local's own register */
+    uint32_t expression(const Expr& expr, uint32_t target = anywhere);
+    /* Appends to exits the jumps taken when the condition is jumpIfTrue */
+    void condition(const Expr& expr, bool jumpIfTrue, std::vector<size_t>& exits);
+
+    static bool assigns(const Expr& expr);
+};
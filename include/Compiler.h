@@ -1,21 +1,61 @@
 #pragma once
 #include "AssemblyInfo.h"
-#include "Environment.h"
 #include "Expression.h"
 #include "Statement.h"
 #include "Token.h"
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 class Compiler {
 public:
-    Environment* environment = new Environment();
+    /* With profile, every statement, loop iteration and JavaStaticCall bumps a counter in the class's $profile array.
+     * A relocatable compiler compiles one top-level statement on its own, for parallel codegen: labels, literal fields
+     * and profile counters get placeholder names that absorb() renumbers. */
+    explicit Compiler(std::string className, bool profile = false, bool relocatable = false)
+        : className { std::move(className) }
+        , profile { profile }
+        , relocatable { relocatable } {};
 
     AssemblyInfo generateAssembly(const Expr& expr);
 
     AssemblyInfo generateAssembly(const Statement& stmt);
 
+    /* Entries of variables whose block has ended; top-level ones are added by generateLocalVariables */
     std::string localVariableTable;
 
-    void generateLocalVariables(AssemblyInfo& info, Environment* environment) const;
+    /* Literal pool: field declarations and the <clinit> code initialising them */
+    std::string constantFields;
+    std::string constantInitializer;
+
+    /* Static fields holding the top-level variables of an imported module */
+    std::string globalFields;
+
+    /* Class and method names of every JavaStaticCall, for native-image reflection metadata */
+    std::map<std::string, std::set<std::string>> javaTargets;
+
+    /* Ends run(): the return, then its line number and local variable tables */
+    void generateLocalVariables(AssemblyInfo& info) const;
+
+    /* Declares $profile and registers the sites with Runtime/JayProfile in <clinit>; source names the .jay file */
+    void generateProfileTable(const std::string& source);
+
+    /* Variable types after the code compiled so far, updated with a rough guess of what the statement stores */
+    [[nodiscard]] const std::vector<AssemblyInfo::Type>& variableTypes() const { return slotTypes; }
+    static void predictVariableTypes(const Statement& stmt, std::vector<AssemblyInfo::Type>& types);
+
+    /* Starts a relocatable compiler from the variable types its statement is expected to see */
+    void assumeVariableTypes(std::vector<AssemblyInfo::Type> types);
+
+    /* Whether a relocatable compiler's statement compiled to what this compiler would generate for it next:
+     * every variable type it read from earlier statements matches, and no literal text clashes with placeholders */
+    [[nodiscard]] bool agreesWith(const Compiler& fragment) const;
+
+    /* Takes over a relocatable compiler's tables and literals as if its statement was compiled here; returns its code
+     * with the placeholders renumbered */
+    std::string absorb(const Compiler& fragment, const std::string& code);
 
 private:
     template <class... Ts>
@@ -29,6 +69,11 @@ private:
 
     static bool isTruthy(const Expr& object);
 
+    /* Whether the expression yields a JayString (or a JayNumber, or a JayBool) whenever it evaluates without throwing */
+    static bool isString(const Expr& expr);
+    static bool isNumber(const Expr& expr);
+    static bool isBoolean(const Expr& expr);
+
     static void checkNumberOperands(const Token& opr, const AssemblyInfo::Type& left, const AssemblyInfo::Type& right)
     {
         if (left == AssemblyInfo::Type::DECIMAL && right == AssemblyInfo::Type::DECIMAL)
@@ -45,16 +90,100 @@ private:
 
     int labelCounter = 0;
 
+    /* Static type of the value last stored in each local slot */
+    std::vector<AssemblyInfo::Type> slotTypes;
+
+    void setSlotType(int slot, AssemblyInfo::Type type);
+    AssemblyInfo::Type slotType(int slot);
+
+    static AssemblyInfo::Type predictType(const Expr& expr, const std::vector<AssemblyInfo::Type>& types);
+
+    std::string className;
+    std::unordered_map<std::string, std::string> constants;
+
+    struct ProfileSite {
+        std::string kind;
+        int line;
+        std::string description;
+    };
+    bool profile;
+    std::vector<ProfileSite> profileSites;
+    /* Line of the statement being compiled, for sites whose own tokens carry none */
+    int currentLine = 0;
+
+    size_t addProfileSite(const std::string& kind, int line, const std::string& description);
+    void emitProfileCount(std::string& code, size_t site);
+
+    /* Relocatable compilers: types read before the statement stored them, slots it stored, literal pool entries in
+     * first-use order, and whether literal text contains placeholder bytes */
+    bool relocatable;
+    std::map<int, AssemblyInfo::Type> assumedTypes;
+    std::set<int> storedSlots;
+    std::vector<std::pair<std::string, std::string>> constantOrder;
+    bool placeholderText = false;
+
+    std::string counterIndex(size_t index) const;
+    std::string literalText(const std::string& text);
+
+    /* Labels statement starts with their source line for the LineNumberTable */
+    std::string lineNumberTable;
+    void markLine(std::string& code, int line);
+
+    /* Named locals of each enclosing block, closed into localVariableTable when the block ends */
+    struct ScopedVariable {
+        int slot;
+        std::string name;
+        std::string start;
+    };
+    std::vector<std::vector<ScopedVariable>> scopes { 1 };
+    void closeScope(const std::string& endLabel);
+
+    /* Loop-invariant expressions already computed into a local before the loop */
+    struct HoistedValue {
+        size_t index;
+        AssemblyInfo::Type type;
+    };
+    std::unordered_map<const Expr*, HoistedValue> hoisted;
+
+    /* For loop counters held in a primitive local, by the slot of their jj declaration; boxed when read */
+    struct Counter {
+        int slot;
+        bool isLong;
+    };
+    std::unordered_map<int, Counter> counters;
+
+    /* A for loop stepping its counter by a constant from an integral start towards the bound */
+    struct CountedLoop {
+        const JJStatement* counter;
+        const While* loop;
+        TokenType comparison;
+        const Expr* bound;
+        /* Set when the bound is an integral literal, so the test needs no boxed value */
+        std::optional<long long> limit;
+        long long start;
+        long long step;
+        bool isLong;
+    };
+    static std::optional<CountedLoop> countedLoop(const Statement& init, const Statement& loop);
+    void generateCounterTest(AssemblyInfo& info, const CountedLoop& counted, const std::string& label, bool jumpIfTrue);
+    auto generateCountedLoop(const CountedLoop& counted) -> AssemblyInfo;
+
+    std::string constantField(const std::string& key, const std::string& loadCode);
+
     std::string generateLabel();
     void emitLabel(std::string& code, const std::string& label);
     void emitJump(std::string& code, const std::string& instruction, const std::string& label);
     void emitInstruction(std::string& code, const std::string& instruction);
     void emitMethodCall(std::string& code, const std::string& className, const std::string& methodName, const std::string& descriptor, const bool& isStatic);
 
-    auto generateLogicalOperation(const Logical& l) -> AssemblyInfo;
+    void generateCondition(AssemblyInfo& info, const Expr& condition, const std::string& label, bool jumpIfTrue);
     auto generateIfElseStatement(const IfStatement& ifStmt) -> AssemblyInfo;
     auto generateWhileStatement(const While& w) -> AssemblyInfo;
+    AssemblyInfo generateStatement(const Statement& stmt);
     AssemblyInfo generateBytecode(const Binary& b);
+    /* Builds a + chain that is known to produce a string in one StringBuilder, wrapping only the result */
+    std::optional<AssemblyInfo> generateConcatenation(const Binary& b);
     AssemblyInfo generateBytecode(const Logical& l);
     AssemblyInfo generateBytecode(const Unary& b);
+    AssemblyInfo generateBytecode(const Ternary& t);
 };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Synthetic .jay sources in shapes that stress different parts of the compiler.
+ * The same shape, size and seed always produce the same text. */
+class CorpusGenerator {
+public:
+    enum class Shape {
+        /* Long runs of assignments over a fixed set of variables */
+        STRAIGHT,
+        /* Deeply parenthesised arithmetic */
+        NESTED,
+        /* Nested blocks, ifs and loops declaring many short-lived variables */
+        BLOCKS,
+        /* Mostly JavaStaticCall */
+        INTEROP
+    };
+
+    static const std::vector<std::pair<std::string, Shape>>& shapes();
+
+    /* At least `bytes` of source, ending on a statement boundary */
+    static std::string generate(Shape shape, size_t bytes, uint32_t seed = 1);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Driver.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/* Keeps a Driver warm and builds scripts for clients connecting over a Unix domain socket.
+ * A request is the client's stdin/stdout/stderr (passed as SCM_RIGHTS), its working directory and its
+ * build arguments; the reply is the exit status. Requests are served concurrently by a fixed set of workers. */
+class Daemon {
+public:
+    Daemon(std::filesystem::path socketPath, size_t workers, const std::string& invokedAs);
+
+    /* Accepts requests until the process is stopped */
+    void serve();
+
+    /* Client side: sends a build to a running daemon and returns its exit status */
+    static int request(const std::filesystem::path& socketPath, const std::vector<std::string>& args);
+
+    /* daemon.sock in the build cache directory */
+    static std::filesystem::path defaultSocket();
+
+private:
+    std::filesystem::path socketPath;
+    Driver driver;
+    ThreadPool workers;
+
+    void handle(int connection);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* An arbitrary-precision decimal with the semantics of java.math.BigDecimal, for the numbers --interp cannot hold
+ * as exact doubles. The value is magnitude * 10^-scale; as with BigDecimal, 1.0 and 1.00 are equal in value but not
+ * the same number, and print differently. */
+class Decimal {
+public:
+    Decimal() = default;
+
+    /* The exact value of a finite double, as new BigDecimal(double) gives it */
+    static Decimal fromDouble(double d);
+    /* The number new BigDecimal(String) reads from Java's decimal or scientific notation */
+    static Decimal parse(std::string_view text);
+
+    [[nodiscard]] Decimal add(const Decimal& other) const;
+    [[nodiscard]] Decimal subtract(const Decimal& other) const;
+    [[nodiscard]] Decimal multiply(const Decimal& other) const;
+    /* Rounded to 34 digits half-even, as with MathContext.DECIMAL128; an exact quotient keeps the scale closest to
+     * the difference of the operands' scales. The divisor must not be zero. */
+    [[nodiscard]] Decimal divide(const Decimal& other) const;
+    [[nodiscard]] Decimal negate() const;
+
+    /* compareTo: by value alone */
+    [[nodiscard]] int compare(const Decimal& other) const;
+    /* equals: by value and scale */
+    bool operator==(const Decimal& other) const;
+
+    [[nodiscard]] bool isZero() const { return magnitude.empty(); }
+    /* The value if it has scale 0 and is below 2^53 in magnitude, where a double holds it exactly */
+    [[nodiscard]] std::optional<double> toInteger() const;
+    /* doubleValue(): the nearest double */
+    [[nodiscard]] double toDouble() const;
+    /* intValue(): truncated, keeping the low 32 bits */
+    [[nodiscard]] int32_t intValue() const;
+
+    /* toString(): scientific notation once the exponent drops below -6 or the scale is negative */
+    void appendTo(std::string& text) const;
+
+private:
+    /* Little-endian base 2^32 limbs without leading zeros; empty for zero */
+    std::vector<uint32_t> magnitude;
+    int32_t scale = 0;
+    bool negative = false;
+
+    Decimal(std::vector<uint32_t> magnitude, int64_t scale, bool negative);
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "BuildCache.h"
+#include "JobScheduler.h"
+#include "Trace.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Settings for one build, from the command line or a daemon request */
+struct Options {
+    int optimizationLevel = 1;
+    bool useCache = true;
+    /* Run the classes on the JVM instead of building a native executable */
+    bool jvm = false;
+    /* Run the scripts in-process on the bytecode interpreter instead of building them */
+    bool interp = false;
+    /* Count statements, loop iterations and JavaStaticCalls in the generated program and report them at exit */
+    bool profile = false;
+    /* Generate each module's top-level statements on a thread pool; the assembly is the same as serial codegen's */
+    bool parallelCodegen = false;
+    /* Print per-phase timings after the build */
+    bool timeReport = false;
+    /* Write a Chrome trace-event file here; traceStatements adds a span per top-level statement */
+    std::string tracePath;
+    bool traceStatements = false;
+    /* Print allocations, live and peak bytes per compiler data structure; needs a JAY_MEMORY_TRACKING build */
+    bool memReport = false;
+    /* Built concurrently, then run one after another in this order */
+    std::vector<std::string> scripts;
+    /* The script, the output directory and the toolchain's relative paths are resolved against this */
+    std::filesystem::path workingDirectory;
+
+    /* Reads build flags and script paths; false if the arguments are not a valid build */
+    static bool parse(const std::vector<std::string>& args, Options& options);
+};
+
+/* Where a build reads input and reports to: the terminal, or the descriptors a daemon client passed over */
+struct Stdio {
+    int in = STDIN_FILENO;
+    int out = STDOUT_FILENO;
+    int err = STDERR_FILENO;
+};
+
+/* Compiles and runs scripts. What does not depend on the script (the build cache, the hash of the compiler
+ * and of the runtime jar, the tool job scheduler) is kept between builds, so a long-lived driver only sets it
+ * up once and concurrent builds share the tool slots */
+class Driver {
+public:
+    /* invokedAs is jj's argv[0], used to find the jj binary when /proc/self/exe is unavailable; the binary's contents
+     * are part of every cache key */
+    explicit Driver(const std::string& invokedAs);
+
+    /* Builds and runs the scripts, or interprets them; returns the exit status for the caller */
+    int run(const Options& options, const Stdio& stdio);
+
+private:
+    /* The command that runs a built script; mode is "native" or "jvm" */
+    struct Program {
+        std::string mode;
+        std::vector<std::string> argv;
+    };
+
+    JobScheduler scheduler;
+    std::filesystem::path compilerPath;
+    /* Hash of the compiler binary, taken the first time a build needs a cache key; unset when it cannot be read */
+    bool compilerHashed = false;
+    std::optional<BuildCache::Key> compilerKey;
+
+    std::mutex mutex;
+    std::unique_ptr<BuildCache> cache;
+    /* Runtime jar path to its modification time when hashed, and the key including its contents */
+    std::unordered_map<std::string, std::pair<std::filesystem::file_time_type, BuildCache::Key>> runtimeKeys;
+
+    BuildCache& buildCache();
+    /* Unset when the compiler binary cannot be hashed, in which case builds bypass the cache */
+    std::optional<BuildCache::Key> toolchainKey(const std::filesystem::path& runtimeJar);
+
+    Program build(const std::string& script, const Options& options, const Stdio& stdio, Trace& trace);
+    /* Lowers the script and its imports to bytecode and runs it in-process; throws on compile or runtime errors */
+    void interpret(const std::string& script, const Options& options, const Stdio& stdio, Trace& trace);
+};
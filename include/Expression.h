@@ -31,6 +31,9 @@ struct Grouping {
 struct Assign {
     const Token name;
     std::shared_ptr<Expr> value;
+    /* JVM local slot, or the class holding it as a static field; filled in by the Resolver */
+    int slot = -1;
+    std::string module {};
 };
 
 struct Unary {
@@ -55,7 +58,10 @@ struct Literal {
 
 struct Variable {
     Token name;
-    std::shared_ptr<Expr> value;
+    std::shared_ptr<Expr> value = nullptr;
+    /* JVM local slot, or the class holding it as a static field; filled in by the Resolver */
+    int slot = -1;
+    std::string module {};
 };
 
 struct Logical {
@@ -83,3 +89,6 @@ public:
 };
 
 std::ostream& operator<<(std::ostream& os, const Expr& expr);
+
+/* Shortest text that reads back as d, written as a Krakatau double constant */
+std::string doubleText(double d);
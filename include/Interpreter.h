@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Bytecode.h"
+#include "Decimal.h"
+#include "StringArena.h"
+#include "Value.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+/* Runs BytecodeProgram modules in-process for --interp. Dispatch is direct-threaded: each chunk is translated once
+ * into handler addresses that the next instruction jumps to with computed goto. log output is formatted straight
+ * into a buffer written to the output descriptor in large blocks. Numbers follow BigDecimal as JayLib does: integers
+ * take a double fast path, and every other result is computed exactly, or to 34 digits for division. */
+class Interpreter {
+public:
+    Interpreter(const BytecodeProgram& program, int out);
+    ~Interpreter();
+
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+
+    /* Runs the module's top level, and through its imports every module it uses. A runtime error throws with the
+     * .jay file and line it happened at; output logged before it has been written. */
+    void run(uint32_t module);
+
+private:
+    struct Threaded {
+        const void* handler;
+        uint32_t a;
+        uint32_t b;
+        uint32_t c;
+    };
+
+    const BytecodeProgram& program;
+    int out;
+    StringArena strings;
+    /* Numbers that are not small integers; like strings, kept until the program ends */
+    std::deque<Decimal> decimals;
+    std::vector<Value> globals;
+    std::vector<bool> initialized;
+    std::vector<std::vector<Threaded>> code;
+    std::vector<std::vector<Value>> constants;
+    std::string output;
+    /* JAY_LOG_LINE_BUFFERED writes each line as it is logged, as the JVM runtime does */
+    bool lineBuffered;
+    /* Formatting space for string concatenation */
+    std::string scratch;
+
+    void execute(uint32_t module);
+    void flush();
+
+    static Decimal toDecimal(Value value);
+    Value number(Decimal value);
+
+    void append(std::string& text, Value value) const;
+    Value add(Value left, Value right);
+    Value subtract(Value left, Value right);
+    Value multiply(Value left, Value right);
+    Value divide(Value left, Value right);
+    Value negate(Value value);
+    Value call(Builtin builtin, const Value* args);
+    static bool equal(Value left, Value right);
+    static int compare(Value left, Value right);
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Runs external tools as a graph of jobs. A job starts once all of its dependencies have succeeded and its
+ * pool has a free slot, and is skipped if any dependency failed. Tools are started with posix_spawn, without a
+ * shell, and each job's wall time is reported to its stderr when it finishes. */
+class JobScheduler {
+public:
+    struct Job {
+        /* Shown in the timing report, e.g. "krak2 util" */
+        std::string name;
+        /* Jobs in the same pool share its slot limit */
+        std::string pool;
+        std::vector<std::string> argv;
+        std::filesystem::path workingDirectory;
+        int in = 0;
+        int out = 1;
+        int err = 2;
+        /* Collect the tool's stdout and stderr instead of passing them through */
+        bool capture = true;
+    };
+
+    struct Result {
+        bool skipped = false;
+        int status = -1;
+        std::string output;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+
+        [[nodiscard]] bool succeeded() const { return !skipped && status == 0; }
+    };
+
+    struct Entry;
+    using Handle = std::shared_ptr<Entry>;
+
+    /* Pools without a limit run every ready job at once */
+    explicit JobScheduler(std::map<std::string, size_t> limits);
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    Handle submit(Job job, std::vector<Handle> dependencies = {});
+
+    /* Blocks until the job has run or been skipped */
+    const Result& wait(const Handle& job);
+
+    /* How many native-image builds fit at once: each wants several cores and a few GiB of memory */
+    static size_t nativeImageSlots();
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Handle> pending;
+    std::map<std::string, size_t> limits;
+    std::map<std::string, size_t> running;
+    size_t active = 0;
+    bool stopping = false;
+
+    void dispatch();
+    void execute(const Handle& job);
+};
+
+struct JobScheduler::Entry {
+    Job job;
+    std::vector<Handle> dependencies;
+    Result result;
+    bool finished = false;
+};
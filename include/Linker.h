@@ -1,14 +1,25 @@
 #pragma once
 
+#include <cstddef>
+#include <fstream>
 #include <string>
+#include <vector>
 
+/* Streams the generated class to disk as code is added; only the literal pool is held until close */
 class Linker {
 public:
-    explicit Linker(const std::string &className);
+    Linker(const std::string &className, const std::string &filename, size_t locals);
 
     void addCode(const std::string &code);
-    void writeToFile(const std::string &filename) const;
+    void addConstants(const std::string &fields, const std::string &initializer);
+    void close();
 
 private:
-    std::string code;
-};
\ No newline at end of file
+    static constexpr size_t bufferSize = 1 << 20;
+
+    std::string className;
+    std::vector<char> buffer;
+    std::ofstream file;
+    std::string fields;
+    std::string initializer;
+};
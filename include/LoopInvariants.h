@@ -0,0 +1,38 @@
+#pragma once
+#include "Expression.h"
+#include "Statement.h"
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/* Finds pure subexpressions of a while loop that do not change between iterations */
+class LoopInvariants {
+public:
+    /* Maximal invariant subexpressions that every iteration evaluates, in evaluation order */
+    static std::vector<std::shared_ptr<Expr>> find(const While& loop);
+
+    static std::unordered_set<std::string> assignedVariables(const Statement& body);
+
+    /* JavaStaticCall targets known to have no side effects */
+    static bool isPureCall(const Call& call);
+
+    /* Expressions whose evaluation can never raise a runtime error, whatever the variables hold */
+    static bool cannotThrow(const Expr& expr);
+
+private:
+    static void collectAssigned(const Statement& stmt, std::unordered_set<std::string>& assigned);
+    static void collectAssigned(const Expr& expr, std::unordered_set<std::string>& assigned);
+
+    static bool isInvariant(const Expr& expr, const std::unordered_set<std::string>& assigned);
+    static bool isWorthHoisting(const Expr& expr);
+
+    static bool hasEffects(const Expr& expr);
+    static bool hasEffects(const Statement& stmt);
+
+    /* effects records whether an observable side effect precedes the current position in the first pass */
+    static void collectHoistable(const std::shared_ptr<Expr>& expr, const std::unordered_set<std::string>& assigned,
+        std::vector<std::shared_ptr<Expr>>& out, bool& effects);
+    static void collectHoistable(const Statement& stmt, const std::unordered_set<std::string>& assigned,
+        std::vector<std::shared_ptr<Expr>>& out, bool& effects);
+};
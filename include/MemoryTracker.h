@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+/* Attributes heap allocations to the compiler data structure being built when they were made.
+ * Counting needs the global operator new/delete in MemoryTracker.cpp, which are only compiled with
+ * JAY_MEMORY_TRACKING defined: they put a 16-byte header on every allocation. Scopes cost nothing
+ * otherwise, so call sites do not need to know. */
+class MemoryTracker {
+public:
+    enum class Category {
+        OTHER,
+        /* Token vector and lexemes */
+        TOKENS,
+        /* Expr and Statement nodes built by the parser */
+        AST,
+        /* Declaration tables and rewritten nodes */
+        OPTIMIZER,
+        /* Resolver scopes and slot assignments */
+        SYMBOLS,
+        /* AssemblyInfo code strings and the literal pool */
+        CODE,
+        /* Linker buffer and class file output */
+        LINK,
+        COUNT
+    };
+
+    /* Allocations on this thread belong to category until the scope ends */
+    class Scope {
+    public:
+        explicit Scope(Category category);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Category previous;
+    };
+
+    /* Whether this build counts allocations at all */
+    static bool enabled();
+
+    /* Allocations, bytes allocated, live bytes and peak live bytes per category */
+    static std::string report();
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+
+/* Writes the native-image metadata for the Java methods a program reaches through JavaStaticCall,
+ * so only those are registered for reflection */
+class NativeImageConfig {
+public:
+    /* Class name to the method names called on it */
+    using Targets = std::map<std::string, std::set<std::string>>;
+
+    /* One "class method" pair per line, kept beside each module's class */
+    static void saveTargets(const Targets& targets, const std::filesystem::path& file);
+    static void loadTargets(const std::filesystem::path& file, Targets& targets);
+
+    /* reflect-config.json, resource-config.json and serialization-config.json */
+    static void write(const Targets& targets, const std::filesystem::path& directory);
+
+private:
+    static std::string quote(const std::string& text);
+};
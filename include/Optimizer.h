@@ -0,0 +1,80 @@
+#pragma once
+#include "Expression.h"
+#include "Statement.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Rewrites the parsed program before codegen.
+ * -O1: constant and copy propagation of never-reassigned variables, dead store elimination
+ * -O2: additionally reuses repeated pure subexpressions through temporaries
+ * Top-level variables of an imported module are visible to other modules, so they are never removed or propagated. */
+class Optimizer {
+public:
+    explicit Optimizer(int level, bool exportsGlobals = false)
+        : level { level }
+        , exportsGlobals { exportsGlobals } {};
+
+    void optimize(std::vector<std::shared_ptr<Statement>>& program);
+
+private:
+    /* Every jj declaration in the program; variables with no writes behave like SSA values */
+    struct Declaration {
+        std::string name;
+        int line;
+        size_t reads = 0;
+        size_t writes = 0;
+        std::shared_ptr<Expr> constant = nullptr;
+        std::optional<size_t> copyOf = std::nullopt;
+    };
+
+    struct Candidate {
+        size_t count = 0;
+        size_t first = 0;
+        std::optional<size_t> temporary;
+    };
+
+    int level;
+    bool exportsGlobals;
+    size_t temporaries = 0;
+
+    std::vector<Declaration> declarations;
+    std::unordered_map<const Expr*, size_t> references;
+    std::unordered_map<const Statement*, size_t> definitions;
+    std::vector<std::unordered_map<std::string, size_t>> scopes;
+
+    std::optional<size_t> lookup(const std::string& name) const;
+
+    /* ----- Name resolution ----- */
+    void resolve(const std::vector<std::shared_ptr<Statement>>& program);
+    void resolve(const Statement& stmt);
+    void resolve(const Expr& expr);
+
+    /* ----- Constant and copy propagation ----- */
+    void propagate(std::vector<std::shared_ptr<Statement>>& statements);
+    void propagate(Statement& stmt);
+    void propagate(std::shared_ptr<Expr>& expr);
+
+    /* ----- Dead code elimination ----- */
+    bool eliminateDeadCode(std::vector<std::shared_ptr<Statement>>& statements);
+    bool eliminateDeadCode(Statement& stmt);
+    bool isDead(const Statement& stmt) const;
+    bool isPure(const Expr& expr) const;
+
+    /* ----- Value numbering ----- */
+    void numberValues(std::vector<std::shared_ptr<Statement>>& statements);
+    void numberNested(Statement& stmt);
+    void countValues(const std::shared_ptr<Expr>& expr, size_t index, std::unordered_map<std::string, Candidate>& candidates);
+    void countValues(const Statement& stmt, size_t index, std::unordered_map<std::string, Candidate>& candidates);
+    void replaceValues(std::shared_ptr<Expr>& expr, size_t index, std::unordered_map<std::string, Candidate>& candidates,
+        std::vector<std::pair<size_t, std::shared_ptr<Statement>>>& temps);
+    void replaceValues(Statement& stmt, size_t index, std::unordered_map<std::string, Candidate>& candidates,
+        std::vector<std::pair<size_t, std::shared_ptr<Statement>>>& temps);
+    std::optional<std::string> valueKey(const Expr& expr) const;
+    static bool isTrivial(const Expr& expr);
+    static bool isCandidate(const Expr& expr);
+
+    std::shared_ptr<Expr> makeVariable(size_t declaration);
+};
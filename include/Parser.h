@@ -52,6 +52,10 @@ private:
     std::shared_ptr<Statement> declaration();
 
     std::shared_ptr<Statement> whileStatement();
+
+    /* Desugars to a block holding the initializer and a while loop marked as counted */
+    std::shared_ptr<Statement> forStatement();
+
     /* Returns null for else block if else block does not exist */
     std::shared_ptr<Statement> ifStatement();
 
@@ -59,6 +63,8 @@ private:
 
     std::shared_ptr<Statement> jjdeclaration();
 
+    std::shared_ptr<Statement> importDeclaration();
+
     std::shared_ptr<Statement> expressionStatement();
 
     std::shared_ptr<Statement> blockStatement();
@@ -0,0 +1,61 @@
+#pragma once
+#include "Expression.h"
+#include "Statement.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/* Binds every variable reference to a JVM local slot before codegen.
+ * Slots are handed out in declaration order and reused once their scope ends.
+ * Top-level variables of an imported module live in static fields of its class instead,
+ * and names a module does not declare are looked up in the modules it imports. */
+class Resolver {
+public:
+    /* Module name -> top-level variables it exports */
+    using Exports = std::unordered_map<std::string, std::unordered_set<std::string>>;
+
+    Resolver() = default;
+
+    Resolver(std::string module, bool exportsGlobals, const Exports& exports)
+        : module { std::move(module) }
+        , exportsGlobals { exportsGlobals }
+        , exports { &exports } {};
+
+    void resolve(std::vector<std::shared_ptr<Statement>>& program);
+
+    /* Highest number of slots live at once, for the method header */
+    size_t maxLocals = 0;
+
+private:
+    /* A slot of -1 is a static field of this module */
+    struct Local {
+        std::string name;
+        int slot;
+    };
+
+    std::string module;
+    bool exportsGlobals = false;
+    const Exports* exports = nullptr;
+    std::vector<std::string> imported;
+
+    /* Flat scope stack: a scope is the tail of locals starting at its recorded index */
+    std::vector<Local> locals;
+    std::vector<std::pair<size_t, int>> scopes;
+    int nextSlot = 0;
+
+    /* Expressions already hoisted by an enclosing loop */
+    std::unordered_set<const Expr*> claimed;
+
+    void resolve(Statement& stmt);
+    void resolve(Expr& expr);
+
+    void beginScope();
+    void endScope();
+
+    int declare(const std::string& name);
+    int allocate();
+    bool lookup(const std::string& name, int& slot, std::string& owner) const;
+};
@@ -12,24 +12,8 @@ class Scanner {
     size_t current = 0;
     size_t line = 0;
 
-    std::unordered_map<std::string, TokenType> keywords{
-        {"and", TokenType::AND},
-        {"class", TokenType::CLASS},
-        {"else", TokenType::ELSE},
-        {"false", TokenType::FALSE},
-        {"for", TokenType::FOR},
-        {"func", TokenType::FUNC},
-        {"if", TokenType::IF},
-        {"nil", TokenType::NIL},
-        {"or", TokenType::OR},
-        {"log", TokenType::LOG},
-        {"return", TokenType::RETURN},
-        {"super", TokenType::SUPER},
-        {"this", TokenType::THIS},
-        {"true", TokenType::TRUE},
-        {"jj", TokenType::JJ},
-        {"while", TokenType::WHILE},
-    };
+    /* Shared by every scanner; built once per process */
+    static const std::unordered_map<std::string, TokenType> keywords;
 
     char peek();
 
@@ -4,9 +4,9 @@
 
 class Statement {
 public:
-    std::variant<ExprStatement, PrintStatement, JJStatement, Block, IfStatement, While, Function> content;
+    std::variant<ExprStatement, PrintStatement, JJStatement, Block, IfStatement, While, Function, Import> content;
 
-    explicit Statement(std::variant<ExprStatement, PrintStatement, JJStatement, Block, IfStatement, While, Function> content)
+    explicit Statement(std::variant<ExprStatement, PrintStatement, JJStatement, Block, IfStatement, While, Function, Import> content)
         : content(std::move(content))
     {
     }
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Value.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/* Bump allocator for the interpreter's strings. Nothing is freed until the arena goes away with the program,
+ * which suits short-lived scripts better than reference counting every value. */
+class StringArena {
+public:
+    StringArena() = default;
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    const StringObject* make(std::string_view text);
+    const StringObject* concat(std::string_view left, std::string_view right);
+
+private:
+    static constexpr size_t blockSize = 64 << 10;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* next = nullptr;
+    size_t left = 0;
+
+    /* A string of length bytes whose contents the caller fills in */
+    StringObject* allocate(size_t length);
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads draining a shared task queue.
+ * Tasks may submit further tasks; wait() returns once the queue is empty and every worker is idle. */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workers = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    /* Blocks until all submitted work is done, rethrowing the first exception a task threw */
+    void wait();
+
+    [[nodiscard]] size_t size() const { return threads.size(); }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable idle;
+    size_t active = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void work();
+};
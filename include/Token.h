@@ -47,6 +47,7 @@ enum class TokenType {
     TRUE,
     JJ,
     WHILE,
+    IMPORT,
 
     NONE,
     ENDOFFILE
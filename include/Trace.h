@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Timed spans of a build, for the --time-report summary and a Chrome trace-event file (--trace).
+ * When disabled, opening a span costs a branch. */
+class Trace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /* Records the time from construction to destruction as one span */
+    class Span {
+    public:
+        Span(Trace& trace, std::string name, std::string detail = "");
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        Trace& trace;
+        std::string name;
+        std::string detail;
+        Clock::time_point start;
+    };
+
+    explicit Trace(bool enabled = false, bool statements = false);
+
+    [[nodiscard]] bool enabled() const { return on; }
+    /* Whether codegen records a span per top-level statement */
+    [[nodiscard]] bool statements() const { return perStatement; }
+
+    /* A finished span; lane names the timeline row it is drawn on, the calling thread's by default */
+    void record(const std::string& name, const std::string& detail, Clock::time_point start, Clock::time_point end,
+        const std::string& lane = "");
+
+    /* Per phase: spans, total and longest time, and share of the build's wall time */
+    [[nodiscard]] std::string report() const;
+    void writeChromeTrace(const std::filesystem::path& file) const;
+
+private:
+    struct Event {
+        std::string name;
+        std::string detail;
+        Clock::time_point start;
+        Clock::time_point end;
+        size_t lane;
+    };
+
+    bool on;
+    bool perStatement;
+    Clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<std::string> laneNames;
+    std::map<std::string, size_t> lanes;
+    std::map<std::thread::id, size_t> threadLanes;
+};
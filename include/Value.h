@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/* An immutable string laid out in a StringArena, its bytes directly after the header */
+struct StringObject {
+    size_t length;
+
+    [[nodiscard]] const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    [[nodiscard]] std::string_view view() const { return { data(), length }; }
+};
+
+class Decimal;
+
+/* A JayLang value in 64 bits. Integers below 2^53 in magnitude, which BigDecimal would hold with scale 0, are plain
+ * doubles; every other number is a Decimal. nil, booleans, strings and decimals live in the payload of a quiet NaN,
+ * which integer arithmetic never produces. */
+class Value {
+public:
+    Value()
+        : bits(NIL)
+    {
+    }
+
+    static Value integer(double d)
+    {
+        Value value;
+        std::memcpy(&value.bits, &d, sizeof(d));
+        return value;
+    }
+
+    static Value nil() { return {}; }
+
+    static Value boolean(bool b)
+    {
+        Value value;
+        value.bits = b ? TRUE : FALSE;
+        return value;
+    }
+
+    static Value string(const StringObject* s)
+    {
+        Value value;
+        value.bits = STRING | reinterpret_cast<uintptr_t>(s);
+        return value;
+    }
+
+    static Value decimal(const Decimal* d)
+    {
+        Value value;
+        value.bits = DECIMAL | reinterpret_cast<uintptr_t>(d);
+        return value;
+    }
+
+    [[nodiscard]] bool isInteger() const { return (bits & QNAN) != QNAN; }
+    [[nodiscard]] bool isDecimal() const { return (bits & (STRING | DECIMAL)) == DECIMAL; }
+    [[nodiscard]] bool isNumber() const { return isInteger() || isDecimal(); }
+    [[nodiscard]] bool isNil() const { return bits == NIL; }
+    [[nodiscard]] bool isBool() const { return (bits | 1) == TRUE; }
+    [[nodiscard]] bool isString() const { return (bits & STRING) == STRING; }
+
+    [[nodiscard]] double asInteger() const
+    {
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    [[nodiscard]] bool asBool() const { return bits == TRUE; }
+    [[nodiscard]] const StringObject* asString() const { return reinterpret_cast<const StringObject*>(bits & ~STRING); }
+    [[nodiscard]] const Decimal* asDecimal() const { return reinterpret_cast<const Decimal*>(bits & ~DECIMAL); }
+
+    /* Only nil and false are falsy, as in JayObject.isTruthy */
+    [[nodiscard]] bool isTruthy() const { return bits != NIL && bits != FALSE; }
+
+    /* Same bits: the identity JayBool and JayNil compare by */
+    [[nodiscard]] bool identical(Value other) const { return bits == other.bits; }
+
+private:
+    static constexpr uint64_t QNAN = 0x7ffc000000000000;
+    static constexpr uint64_t STRING = 0x8000000000000000 | QNAN;
+    static constexpr uint64_t DECIMAL = 0x0001000000000000 | QNAN;
+    static constexpr uint64_t NIL = QNAN | 1;
+    static constexpr uint64_t FALSE = QNAN | 2;
+    static constexpr uint64_t TRUE = QNAN | 3;
+
+    uint64_t bits;
+};
@@ -4,31 +4,55 @@
 
 class Statement;
 
+/* line is the source line the statement starts on, for statements whose expression may not carry one (a literal) */
 struct ExprStatement {
     std::shared_ptr<Expr> expression;
+    int line = -1;
 };
 
 struct PrintStatement {
     std::shared_ptr<Expr> expression;
+    int line = -1;
 };
 
 struct JJStatement {
     Token name;
     std::shared_ptr<Expr> value;
+    /* JVM local slot, or the class holding it as a static field; filled in by the Resolver */
+    int slot = -1;
+    std::string module {};
 };
 
 struct Block {
     std::vector<std::shared_ptr<Statement>> statements;
 };
 
+struct HoistedExpr {
+    std::shared_ptr<Expr> expression;
+    int slot;
+};
+
 struct While {
     std::shared_ptr<Expr> condition;
     std::shared_ptr<Statement> body;
+    /* Loop-invariant expressions computed once before the loop, filled in by the Resolver */
+    std::vector<HoistedExpr> invariants {};
+    /* Parsed from a for loop: the counter is declared just before the loop and stepped at the end of the body */
+    bool counted = false;
+    /* First of two slots for a primitive copy of the counter, reserved by the Resolver for counted loops */
+    int counterSlot = -1;
+    /* Line of the while or for keyword */
+    int line = -1;
 };
 struct IfStatement {
     std::shared_ptr<Expr> condition;
     std::shared_ptr<Statement> ifBlock;
     std::shared_ptr<Statement> elseBlock;
+    int line = -1;
+};
+
+struct Import {
+    Token module;
 };
 
 struct Function {
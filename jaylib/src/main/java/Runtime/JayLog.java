@@ -0,0 +1,82 @@
+package Runtime;
+
+import java.io.FileDescriptor;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Output of log statements. Lines collect in one unsynchronised buffer that is written to stdout when it fills,
+ * when the program calls flush() and when it exits. With JAY_LOG_LINE_BUFFERED set every line is written as soon
+ * as it is logged, for interactive programs.
+ */
+public final class JayLog {
+    private static final int BUFFER_SIZE = 1 << 16;
+    private static final boolean LINE_BUFFERED = System.getenv("JAY_LOG_LINE_BUFFERED") != null;
+
+    private static final FileOutputStream out = new FileOutputStream(FileDescriptor.out);
+    private static final byte[] buffer = new byte[BUFFER_SIZE];
+    private static int size;
+
+    static {
+        java.lang.Runtime.getRuntime().addShutdownHook(new Thread(JayLog::flush));
+    }
+
+    private JayLog() {
+    }
+
+    public static void println(String line) {
+        int length = line.length();
+        if (size + length + 1 > BUFFER_SIZE) {
+            flush();
+        }
+        if (length + 1 > BUFFER_SIZE) {
+            byte[] bytes = line.getBytes(StandardCharsets.UTF_8);
+            write(bytes, bytes.length);
+        } else {
+            // ASCII goes straight into the buffer; anything else is encoded by the JDK
+            int start = size;
+            for (int i = 0; i < length; i++) {
+                char c = line.charAt(i);
+                if (c >= 0x80) {
+                    size = start;
+                    append(line.getBytes(StandardCharsets.UTF_8));
+                    break;
+                }
+                buffer[size++] = (byte) c;
+            }
+        }
+        buffer[size++] = '\n';
+        if (LINE_BUFFERED) {
+            flush();
+        }
+    }
+
+    public static void flush() {
+        if (size > 0) {
+            write(buffer, size);
+            size = 0;
+        }
+    }
+
+    /* Encoded lines can outgrow the character count the room was checked against */
+    private static void append(byte[] bytes) {
+        if (size + bytes.length + 1 > BUFFER_SIZE) {
+            flush();
+        }
+        if (bytes.length + 1 > BUFFER_SIZE) {
+            write(bytes, bytes.length);
+            return;
+        }
+        System.arraycopy(bytes, 0, buffer, size, bytes.length);
+        size += bytes.length;
+    }
+
+    private static void write(byte[] bytes, int length) {
+        try {
+            out.write(bytes, 0, length);
+        } catch (IOException e) {
+            // Like System.out, a closed stdout loses the output rather than failing the program
+        }
+    }
+}
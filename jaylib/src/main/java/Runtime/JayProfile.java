@@ -0,0 +1,69 @@
+package Runtime;
+
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.List;
+
+/**
+ * Counters for programs built with jj --profile. Each profiled class gets one long[] holding a count and a
+ * cumulative nanoTime per site; the hottest sites of every class are printed to stderr when the program exits.
+ */
+public final class JayProfile {
+    private static final int REPORTED_SITES = 40;
+
+    private record Site(String location, String kind, String description, long[] counters, int index) {
+        long count() {
+            return counters[2 * index];
+        }
+
+        long nanos() {
+            return counters[2 * index + 1];
+        }
+    }
+
+    private static final List<Site> sites = new ArrayList<>();
+
+    static {
+        java.lang.Runtime.getRuntime().addShutdownHook(new Thread(JayProfile::report));
+    }
+
+    private JayProfile() {
+    }
+
+    /**
+     * Called from a profiled class's static initialiser. The table is "source;kind|line|description;..." with one
+     * entry per site, in the order the generated code indexes them.
+     */
+    public static synchronized long[] counters(String table) {
+        String[] entries = table.split(";");
+        long[] counters = new long[2 * (entries.length - 1)];
+        for (int i = 1; i < entries.length; i++) {
+            String[] fields = entries[i].split("\\|", 3);
+            sites.add(new Site(entries[0] + ":" + fields[1], fields[0], fields[2], counters, i - 1));
+        }
+        return counters;
+    }
+
+    private static synchronized void report() {
+        List<Site> hot = new ArrayList<>();
+        for (Site site : sites) {
+            if (site.count() > 0) {
+                hot.add(site);
+            }
+        }
+        hot.sort(Comparator.comparingLong(Site::count).reversed());
+
+        StringBuilder out = new StringBuilder("jj profile: hottest sites\n");
+        out.append(String.format("%14s %12s  %-24s %-10s %s%n", "count", "total ms", "site", "kind", "code"));
+        for (Site site : hot.subList(0, Math.min(hot.size(), REPORTED_SITES))) {
+            String millis = site.kind().equals("call") ? String.format("%.3f", site.nanos() / 1e6) : "";
+            out.append(String.format("%14d %12s  %-24s %-10s %s%n", site.count(), millis, site.location(), site.kind(),
+                    site.description()));
+        }
+        if (hot.size() > REPORTED_SITES) {
+            out.append(hot.size() - REPORTED_SITES).append(" more sites ran\n");
+        }
+        System.err.print(out);
+        System.err.flush();
+    }
+}
@@ -0,0 +1,25 @@
+package Types;
+
+public final class JayBool extends JayObject<Boolean> {
+    public static final JayBool TRUE = new JayBool(true);
+    public static final JayBool FALSE = new JayBool(false);
+
+    private JayBool(boolean value) {
+        super(value);
+    }
+
+    @Override
+    public Type getType() {
+        return Type.BOOLEAN;
+    }
+
+    @Override
+    public boolean isTruthy() {
+        return value;
+    }
+
+    @Override
+    public boolean equal(JayObject<?> object) {
+        return this == object;
+    }
+}
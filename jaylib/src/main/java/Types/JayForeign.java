@@ -0,0 +1,12 @@
+package Types;
+
+public final class JayForeign extends JayObject<Object> {
+    public JayForeign(Object value) {
+        super(value);
+    }
+
+    @Override
+    public Type getType() {
+        return Type.OBJECT;
+    }
+}
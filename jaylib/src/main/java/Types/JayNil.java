@@ -0,0 +1,29 @@
+package Types;
+
+public final class JayNil extends JayObject<Void> {
+    public static final JayNil INSTANCE = new JayNil();
+
+    private JayNil() {
+        super(null);
+    }
+
+    @Override
+    public Type getType() {
+        return Type.NIL;
+    }
+
+    @Override
+    public boolean isTruthy() {
+        return false;
+    }
+
+    @Override
+    public boolean equal(JayObject<?> object) {
+        return this == object;
+    }
+
+    @Override
+    public String toString() {
+        return "nil";
+    }
+}
@@ -0,0 +1,84 @@
+package Types;
+
+import java.math.BigDecimal;
+import java.math.MathContext;
+
+public final class JayNumber extends JayObject<BigDecimal> {
+    public JayNumber(BigDecimal value) {
+        super(value);
+    }
+
+    @Override
+    public Type getType() {
+        return Type.DECIMAL;
+    }
+
+    @Override
+    public Object getJavaObject() {
+        return value.doubleValue();
+    }
+
+    @Override
+    public Number getNumber() {
+        return value;
+    }
+
+    @Override
+    public int compareTo(JayObject<?> object) {
+        if (object instanceof JayNumber number) {
+            return value.compareTo(number.value);
+        }
+        throw typeMismatch();
+    }
+
+    @Override
+    public int compareCounter(long counter) {
+        // Doubles hold counters up to 2^53 exactly and rounding keeps order, so differing doubles decide it
+        double bound = value.doubleValue();
+        if (Math.abs(counter) <= (1L << 53) && (double) counter != bound) {
+            return Double.compare(counter, bound);
+        }
+        return BigDecimal.valueOf(counter).compareTo(value);
+    }
+
+    @Override
+    public JayObject<?> negate() {
+        return new JayNumber(value.negate());
+    }
+
+    @Override
+    public JayObject<?> add(JayObject<?> add) {
+        if (add instanceof JayNumber number) {
+            return new JayNumber(value.add(number.value));
+        } else if (add instanceof JayString string) {
+            return new JayString(value.toString() + string.value);
+        }
+        return super.add(add);
+    }
+
+    @Override
+    public JayObject<?> subtract(JayObject<?> sub) {
+        if (sub instanceof JayNumber number) {
+            return new JayNumber(value.subtract(number.value));
+        }
+        return super.subtract(sub);
+    }
+
+    @Override
+    public JayObject<?> multiply(JayObject<?> mul) {
+        if (mul instanceof JayNumber number) {
+            return new JayNumber(value.multiply(number.value));
+        } else if (mul instanceof JayString string) {
+            return new JayString(string.value.repeat(value.intValue()));
+        }
+        return super.multiply(mul);
+    }
+
+    @Override
+    public JayObject<?> divide(JayObject<?> div) {
+        if (div instanceof JayNumber number) {
+            return new JayNumber(value.divide(number.value, MathContext.DECIMAL128));
+        }
+        return super.divide(div);
+    }
+}
@@ -3,211 +3,161 @@ package Types;
 import java.math.BigDecimal;
 import java.util.Objects;
 
-public class JayObject<T> implements JayType {
-    private Type type;
-    private T value;
+public abstract sealed class JayObject<T> implements JayType
+        permits JayNumber, JayString, JayBool, JayNil, JayForeign {
+    protected final T value;
 
-    public JayObject(Type type, T value) {
-        this.type = type;
+    protected JayObject(T value) {
         this.value = value;
     }
 
     public static JayObject<?> generateObject(Object obj) {
-        if (obj instanceof Double || obj instanceof Integer || obj instanceof BigDecimal) {
-            return new JayObject<>(Type.DECIMAL, new BigDecimal(obj.toString()));
-        } else if (obj instanceof String) {
-            return new JayObject<>(Type.STRING, (String) obj);
+        if (obj == null) {
+            return JayNil.INSTANCE;
         } else if (obj instanceof JayObject) {
             return (JayObject<?>) obj;
+        } else if (obj instanceof BigDecimal) {
+            return new JayNumber((BigDecimal) obj);
+        } else if (obj instanceof Double || obj instanceof Integer) {
+            return new JayNumber(new BigDecimal(obj.toString()));
+        } else if (obj instanceof String) {
+            return new JayString((String) obj);
+        } else if (obj instanceof Boolean) {
+            return generateObject(((Boolean) obj).booleanValue());
         } else {
-            return new JayObject<>(Type.OBJECT, obj);
+            return new JayForeign(obj);
         }
     }
 
     public static JayObject<BigDecimal> generateObject(double d) {
-        return new JayObject<>(Type.DECIMAL, new BigDecimal(d));
+        return new JayNumber(new BigDecimal(d));
     }
 
     public static JayObject<BigDecimal> generateObject(int i) {
-        return new JayObject<>(Type.DECIMAL, new BigDecimal(i));
+        return new JayNumber(new BigDecimal(i));
     }
 
-    public static JayObject<String> generateObject(String str) {
-        return new JayObject<>(Type.STRING, str);
+    public static JayObject<BigDecimal> generateObject(long l) {
+        return new JayNumber(new BigDecimal(l));
     }
-   public static JayObject<Boolean> generateObject(boolean b) {
-       return new JayObject<>(Type.BOOLEAN, b);
-   }
 
+    public static JayObject<String> generateObject(String str) {
+        return new JayString(str);
+    }
 
-    public Type getType() {
-        return type;
+    public static JayObject<Boolean> generateObject(boolean b) {
+        return b ? JayBool.TRUE : JayBool.FALSE;
     }
 
+    public abstract Type getType();
+
     public T getValue() {
         return value;
     }
 
     public Object getJavaObject() {
-        if (type == Type.DECIMAL) {
-            if (value instanceof BigDecimal) {
-                return ((BigDecimal) value).doubleValue();
-            } else {
-                return new BigDecimal(value.toString()).doubleValue();
-            }
-        } else if (type == Type.BOOLEAN) {
-            return ((Boolean) value).booleanValue();
-        } else {
-            return value;
-        }
+        return value;
     }
 
     public Number getNumber() {
-        if (value instanceof Number) {
-            return (Number) value;
-        } else {
-            throw new IllegalArgumentException("The contained value is not a number");
-        }
+        throw new IllegalArgumentException("The contained value is not a number");
+    }
+
+    public boolean isTruthy() {
+        return true;
+    }
+
+    public boolean not() {
+        return !isTruthy();
     }
 
     @Override
-    public boolean greaterThan(JayObject<?> object) {
-        validateType(object);
-        switch (this.type) {
-            case DECIMAL:
-                return ((BigDecimal) this.value).compareTo((BigDecimal) object.value) > 0;
-            case STRING:
-                return ((String) this.value).compareTo((String) object.value) > 0;
-            default:
-                throw new RuntimeException("Comparison not supported for this type");
-        }
+    public int compareTo(JayObject<?> object) {
+        throw new RuntimeException("Comparison not supported for this type");
+    }
+
+    /**
+     * Compares a for loop's primitive counter with this bound: negative, zero or positive as the counter is less
+     * than, equal to or greater than it.
+     */
+    public int compareCounter(long counter) {
+        throw typeMismatch();
     }
 
     @Override
-    public boolean greaterThanEqual(JayObject<?> object) {
-        return this.greaterThan(object) || this.equal(object);
+    public final boolean greaterThan(JayObject<?> object) {
+        return compareTo(object) > 0;
     }
 
     @Override
-    public boolean lessThan(JayObject<?> object) {
-        validateType(object);
-        switch (this.type) {
-            case DECIMAL:
-                return ((BigDecimal) this.value).compareTo((BigDecimal) object.value) < 0;
-            case STRING:
-                return ((String) this.value).compareTo((String) object.value) < 0;
-            default:
-                throw new RuntimeException("Comparison not supported for this type");
-        }
+    public final boolean greaterThanEqual(JayObject<?> object) {
+        return compareTo(object) >= 0;
     }
 
     @Override
-    public boolean lessThanEqual(JayObject<?> object) {
-        return this.lessThan(object) || this.equal(object);
+    public final boolean lessThan(JayObject<?> object) {
+        return compareTo(object) < 0;
+    }
+
+    @Override
+    public final boolean lessThanEqual(JayObject<?> object) {
+        return compareTo(object) <= 0;
     }
 
     @Override
     public boolean equal(JayObject<?> object) {
-        if (this.type != object.type)
-            return false;
-        return Objects.equals(this.value, object.value);
+        return getClass() == object.getClass() && Objects.equals(this.value, object.value);
     }
 
     @Override
-    public boolean notEqual(JayObject<?> object) {
+    public final boolean notEqual(JayObject<?> object) {
         return !this.equal(object);
     }
 
     public JayObject<?> negate() {
-        switch (this.type) {
-            case DECIMAL:
-                return new JayObject<>(Type.DECIMAL, ((BigDecimal) this.value).negate());
-            case STRING:
-                return new JayObject<>(Type.STRING, new StringBuilder((String) this.value).reverse().toString());
-            default:
-                throw new RuntimeException("Negation not supported for this type");
-        }
+        throw new RuntimeException("Negation not supported for this type");
     }
 
     public JayObject<?> add(JayObject<?> add) {
-        switch (this.type) {
-            case DECIMAL:
-                if (add.type == Type.DECIMAL) {
-                    return new JayObject<>(Type.DECIMAL, ((BigDecimal) this.value).add((BigDecimal) add.value));
-                } else if (add.type == Type.STRING) {
-                    return new JayObject<>(Type.STRING, this.value.toString() + add.value);
-                }
-                break;
-            case STRING:
-                return new JayObject<>(Type.STRING, this.value.toString() + add.value.toString());
-        }
         throw new RuntimeException("Addition not supported for these types");
     }
 
     public JayObject<?> subtract(JayObject<?> sub) {
-        switch (this.type) {
-            case DECIMAL:
-                if (sub.type == Type.DECIMAL) {
-                    return new JayObject<>(Type.DECIMAL, ((BigDecimal) this.value).subtract((BigDecimal) sub.value));
-                }
-                break;
-            case STRING:
-                if (sub.type == Type.STRING) {
-                    String result = ((String) this.value).replaceFirst((String) sub.value, "");
-                    return new JayObject<>(Type.STRING, result);
-                }
-                break;
-        }
         throw new RuntimeException("Subtraction not supported for these types");
     }
 
     public JayObject<?> multiply(JayObject<?> mul) {
-        switch (this.type) {
-            case DECIMAL:
-                if (mul.type == Type.DECIMAL) {
-                    return new JayObject<>(Type.DECIMAL, ((BigDecimal) this.value).multiply((BigDecimal) mul.value));
-                } else if (mul.type == Type.STRING) {
-                    int times = ((BigDecimal) this.value).intValue();
-                    return new JayObject<>(Type.STRING, ((String) mul.value).repeat(times));
-                }
-                break;
-            case STRING:
-                if (mul.type == Type.DECIMAL) {
-                    int times = ((BigDecimal) mul.value).intValue();
-                    return new JayObject<>(Type.STRING, ((String) this.value).repeat(times));
-                }
-                break;
-        }
         throw new RuntimeException("Multiplication not supported for these types");
     }
 
-    private void validateType(JayObject<?> object) {
-        if (this.type != object.type) {
-            throw new RuntimeException("Type mismatch");
-        }
+    public JayObject<?> divide(JayObject<?> div) {
+        throw new RuntimeException("Division not supported for these types");
+    }
+
+    protected static RuntimeException typeMismatch() {
+        return new RuntimeException("Type mismatch");
     }
 
     @Override
     public boolean equals(Object obj) {
         if (this == obj)
             return true;
-        if (obj == null || getClass() != obj.getClass())
+        if (!(obj instanceof JayObject<?> jayObject))
             return false;
-        JayObject<?> jayObject = (JayObject<?>) obj;
-        return type == jayObject.type && Objects.equals(value, jayObject.value);
+        return equal(jayObject);
     }
 
     @Override
     public int hashCode() {
-        return Objects.hash(type, value);
+        return Objects.hash(getType(), value);
     }
 
     @Override
     public String toString() {
-        return value.toString();
+        return String.valueOf(value);
     }
 
     public enum Type {
-        DECIMAL, STRING, OBJECT, BOOLEAN
+        DECIMAL, STRING, OBJECT, BOOLEAN, NIL
     }
 }
@@ -0,0 +1,46 @@
+package Types;
+
+public final class JayString extends JayObject<String> {
+    public JayString(String value) {
+        super(value);
+    }
+
+    @Override
+    public Type getType() {
+        return Type.STRING;
+    }
+
+    @Override
+    public int compareTo(JayObject<?> object) {
+        if (object instanceof JayString string) {
+            return value.compareTo(string.value);
+        }
+        throw typeMismatch();
+    }
+
+    @Override
+    public JayObject<?> negate() {
+        return new JayString(new StringBuilder(value).reverse().toString());
+    }
+
+    @Override
+    public JayObject<?> add(JayObject<?> add) {
+        return new JayString(value + add.toString());
+    }
+
+    @Override
+    public JayObject<?> subtract(JayObject<?> sub) {
+        if (sub instanceof JayString string) {
+            return new JayString(value.replaceFirst(string.value, ""));
+        }
+        return super.subtract(sub);
+    }
+
+    @Override
+    public JayObject<?> multiply(JayObject<?> mul) {
+        if (mul instanceof JayNumber number) {
+            return new JayString(value.repeat(number.value.intValue()));
+        }
+        return super.multiply(mul);
+    }
+}
@@ -5,6 +5,8 @@ import java.util.Objects;
 
 public interface JayType {
 
+    int compareTo(JayObject<?> object);
+
     boolean greaterThan(JayObject<?> object);
 
     boolean greaterThanEqual(JayObject<?> object);
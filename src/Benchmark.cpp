@@ -0,0 +1,269 @@
+#include "Benchmark.h"
+#include "Compiler.h"
+#include "CorpusGenerator.h"
+#include "Linker.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "Scanner.h"
+#include "Statement.h"
+#include "statementTypes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+template <class... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+template <class... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+using Clock = std::chrono::steady_clock;
+
+enum Phase { SCAN, PARSE, RESOLVE, CODEGEN, LINK, PHASES };
+
+static const char* const phaseNames[PHASES] = { "scan", "parse", "resolve", "codegen", "link" };
+static const char* const unitNames[PHASES] = { "Mtok/s", "Mnode/s", "Mnode/s", "MB/s", "MB/s" };
+
+/* Once a size has been compiled for this long, its averages are stable enough */
+static constexpr double minimumSeconds = 0.2;
+/* A phase whose time grows faster than size^1.5 between two sizes is reported; below that, cache and
+ * allocator effects on growing inputs make the exponent too noisy to act on */
+static constexpr double superLinear = 1.5;
+
+struct Sample {
+    double seconds[PHASES] {};
+    double units[PHASES] {};
+};
+
+static size_t count(const std::shared_ptr<Expr>& expr);
+
+static size_t count(const std::vector<std::shared_ptr<Expr>>& exprs)
+{
+    size_t nodes = 0;
+    for (const auto& expr : exprs) {
+        nodes += count(expr);
+    }
+    return nodes;
+}
+
+static size_t count(const std::shared_ptr<Expr>& expr)
+{
+    if (!expr) {
+        return 0;
+    }
+    return 1
+        + std::visit(overloaded {
+                         [](const Unary& u) { return count(u.value); },
+                         [](const Binary& b) { return count(b.left) + count(b.right); },
+                         [](const Logical& l) { return count(l.left) + count(l.right); },
+                         [](const Grouping& g) { return count(g.expression); },
+                         [](const Ternary& t) { return count(t.condition) + count(t.left) + count(t.right); },
+                         [](const Assign& a) { return count(a.value); },
+                         [](const Call& c) { return count(c.callee) + count(c.args); },
+                         [](const auto&) { return size_t { 0 }; },
+                     },
+            expr->content);
+}
+
+static size_t count(const std::shared_ptr<Statement>& stmt)
+{
+    if (!stmt) {
+        return 0;
+    }
+    return 1
+        + std::visit(overloaded {
+                         [](const ExprStatement& e) { return count(e.expression); },
+                         [](const PrintStatement& p) { return count(p.expression); },
+                         [](const JJStatement& js) { return count(js.value); },
+                         [](const Block& b) {
+                             size_t nodes = 0;
+                             for (const auto& s : b.statements) {
+                                 nodes += count(s);
+                             }
+                             return nodes;
+                         },
+                         [](const IfStatement& i) { return count(i.condition) + count(i.ifBlock) + count(i.elseBlock); },
+                         [](const While& w) { return count(w.condition) + count(w.body); },
+                         [](const auto&) { return size_t { 0 }; },
+                     },
+            stmt->content);
+}
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+/* Compiles the source once, writing the class to output */
+static Sample measure(const std::string& source, const std::filesystem::path& output)
+{
+    Sample sample;
+    Scanner scanner { source };
+
+    auto start = Clock::now();
+    std::vector<Token> tokens = scanner.scanTokens();
+    sample.seconds[SCAN] = seconds(Clock::now() - start);
+    sample.units[SCAN] = static_cast<double>(tokens.size());
+
+    Parser parser { std::move(tokens) };
+    start = Clock::now();
+    std::vector<std::shared_ptr<Statement>> program = parser.parse();
+    sample.seconds[PARSE] = seconds(Clock::now() - start);
+    if (scanner.err.error || parser.err.error) {
+        throw std::runtime_error("Generated corpus does not parse");
+    }
+    size_t nodes = 0;
+    for (const auto& stmt : program) {
+        nodes += count(stmt);
+    }
+    sample.units[PARSE] = sample.units[RESOLVE] = static_cast<double>(nodes);
+
+    Resolver resolver {};
+    start = Clock::now();
+    resolver.resolve(program);
+    sample.seconds[RESOLVE] = seconds(Clock::now() - start);
+
+    Compiler compiler { "Bench" };
+    Linker linker { "Bench", output.string(), resolver.maxLocals };
+    Clock::duration codegen {};
+    Clock::duration link {};
+    for (const auto& stmt : program) {
+        start = Clock::now();
+        AssemblyInfo info = compiler.generateAssembly(*stmt);
+        const auto generated = Clock::now();
+        linker.addCode(info.code);
+        codegen += generated - start;
+        link += Clock::now() - generated;
+        sample.units[CODEGEN] += static_cast<double>(info.code.size());
+    }
+    start = Clock::now();
+    AssemblyInfo locals {};
+    compiler.generateLocalVariables(locals);
+    linker.addCode(locals.code);
+    linker.addConstants(compiler.constantFields + compiler.globalFields, compiler.constantInitializer);
+    linker.close();
+    link += Clock::now() - start;
+
+    sample.seconds[CODEGEN] = seconds(codegen);
+    sample.seconds[LINK] = seconds(link);
+    sample.units[LINK] = static_cast<double>(std::filesystem::file_size(output));
+    return sample;
+}
+
+static std::string formatSize(size_t bytes)
+{
+    static const char* const suffixes[] = { "B", "K", "M", "G" };
+    int suffix = 0;
+    double value = static_cast<double>(bytes);
+    while (value >= 1024 && suffix < 3) {
+        value /= 1024;
+        suffix++;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.0f%s", value, suffixes[suffix]);
+    return text;
+}
+
+auto Benchmark::parseSize(const std::string& text) -> size_t
+{
+    size_t end = 0;
+    double value = 0;
+    try {
+        value = std::stod(text, &end);
+    } catch (const std::exception&) {
+        return 0;
+    }
+    const std::string suffix = text.substr(end);
+    if (suffix == "K" || suffix == "k") {
+        value *= 1 << 10;
+    } else if (suffix == "M" || suffix == "m") {
+        value *= 1 << 20;
+    } else if (suffix == "G" || suffix == "g") {
+        value *= 1 << 30;
+    } else if (!suffix.empty()) {
+        return 0;
+    }
+    return value > 0 ? static_cast<size_t>(value) : 0;
+}
+
+auto Benchmark::run(const std::vector<std::string>& shapes, size_t maxBytes, std::ostream& out) -> int
+{
+    std::vector<std::pair<std::string, CorpusGenerator::Shape>> selected;
+    for (const auto& [name, shape] : CorpusGenerator::shapes()) {
+        if (shapes.empty() || std::find(shapes.begin(), shapes.end(), name) != shapes.end()) {
+            selected.emplace_back(name, shape);
+        }
+    }
+    if (selected.size() < std::max<size_t>(shapes.size(), 1)) {
+        throw std::runtime_error("Unknown corpus shape; expected straight, nested, blocks or interop");
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t size = 1 << 10; size <= std::max<size_t>(maxBytes, 1 << 10); size *= 8) {
+        sizes.push_back(size);
+    }
+
+    const auto output = std::filesystem::temp_directory_path() / ("jj-bench-" + std::to_string(getpid()) + ".j");
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-9s %7s %5s  %-8s %12s %14s\n", "shape", "size", "runs", "phase", "ms/run", "throughput");
+    out << line;
+
+    int status = 0;
+    for (const auto& [name, shape] : selected) {
+        std::vector<std::pair<size_t, Sample>> results;
+        for (const size_t size : sizes) {
+            const std::string source = CorpusGenerator::generate(shape, size);
+
+            Sample total;
+            int runs = 0;
+            double elapsed = 0;
+            do {
+                const Sample sample = measure(source, output);
+                for (int phase = 0; phase < PHASES; ++phase) {
+                    total.seconds[phase] += sample.seconds[phase];
+                    total.units[phase] = sample.units[phase];
+                    elapsed += sample.seconds[phase];
+                }
+                runs++;
+            } while (elapsed < minimumSeconds && runs < 1000);
+
+            Sample mean = total;
+            for (int phase = 0; phase < PHASES; ++phase) {
+                mean.seconds[phase] /= runs;
+                const double rate = mean.seconds[phase] > 0 ? mean.units[phase] / mean.seconds[phase] / 1e6 : 0;
+                std::snprintf(line, sizeof(line), "%-9s %7s %5d  %-8s %12.3f %7.2f %-6s\n", name.c_str(),
+                    formatSize(source.size()).c_str(), runs, phaseNames[phase], mean.seconds[phase] * 1e3, rate, unitNames[phase]);
+                out << line;
+            }
+            results.emplace_back(source.size(), mean);
+        }
+
+        for (size_t i = 1; i < results.size(); ++i) {
+            const auto& [smallBytes, small] = results[i - 1];
+            const auto& [largeBytes, large] = results[i];
+            for (int phase = 0; phase < PHASES; ++phase) {
+                // Below a millisecond, timer noise and cache effects swamp the growth
+                if (small.seconds[phase] < 1e-3) {
+                    continue;
+                }
+                const double exponent = std::log(large.seconds[phase] / small.seconds[phase])
+                    / std::log(static_cast<double>(largeBytes) / static_cast<double>(smallBytes));
+                if (exponent > superLinear) {
+                    std::snprintf(line, sizeof(line), "super-linear: %s %s from %s to %s grows as n^%.2f\n", name.c_str(),
+                        phaseNames[phase], formatSize(smallBytes).c_str(), formatSize(largeBytes).c_str(), exponent);
+                    out << line;
+                    status = 1;
+                }
+            }
+        }
+    }
+
+    std::filesystem::remove(output);
+    return status;
+}
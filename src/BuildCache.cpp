@@ -0,0 +1,98 @@
+#include "BuildCache.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unistd.h>
+
+auto BuildCache::Key::mix(std::string_view bytes) -> void
+{
+    for (const unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+}
+
+auto BuildCache::Key::add(std::string_view data) -> Key&
+{
+    mix(std::to_string(data.size()) + ":");
+    mix(data);
+    return *this;
+}
+
+auto BuildCache::Key::addFile(const std::filesystem::path& file) -> Key&
+{
+    std::ifstream ifs { file, std::ios::binary };
+    if (!ifs) {
+        // A missing input still has to change the key compared to an empty one
+        return add("<missing " + file.string() + ">");
+    }
+    const std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return add(data);
+}
+
+auto BuildCache::Key::str() const -> std::string
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        out[i] = digits[(hash >> ((15 - i) * 4)) & 0xf];
+    }
+    return out;
+}
+
+BuildCache::BuildCache(std::filesystem::path directory)
+    : directory(std::move(directory))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->directory, ec);
+}
+
+auto BuildCache::defaultDirectory() -> std::filesystem::path
+{
+    if (const char* dir = std::getenv("JAY_CACHE_DIR")) {
+        return dir;
+    }
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        return std::filesystem::path(xdg) / "jaylang";
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / ".cache" / "jaylang";
+    }
+    return ".jaycache";
+}
+
+auto BuildCache::entry(const std::string& key) const -> std::filesystem::path
+{
+    return directory / key.substr(0, 2) / key;
+}
+
+auto BuildCache::fetch(const std::string& key, const std::filesystem::path& destination) const -> bool
+{
+    const auto path = entry(key);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return false;
+    }
+    std::filesystem::copy_file(path, destination, std::filesystem::copy_options::overwrite_existing, ec);
+    return !ec;
+}
+
+auto BuildCache::store(const std::string& key, const std::filesystem::path& source) const -> bool
+{
+    const auto path = entry(key);
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Copy beside the entry and rename into place so a concurrent jj never sees a partial file
+    const auto temporary = path.string() + ".tmp" + std::to_string(getpid());
+    std::filesystem::copy_file(source, temporary, std::filesystem::copy_options::overwrite_existing, ec);
+    if (!ec) {
+        std::filesystem::rename(temporary, path, ec);
+    }
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
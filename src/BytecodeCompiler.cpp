@@ -0,0 +1,518 @@
+#include "BytecodeCompiler.h"
+#include "statementTypes.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
+
+/* String literals keep their quotes and escapes; krak2 decodes the same escapes on the JVM path */
+static std::string unquote(const std::string& literal)
+{
+    std::string text;
+    for (size_t i = 1; i + 1 < literal.size(); ++i) {
+        if (literal[i] != '\\' || i + 2 >= literal.size()) {
+            text += literal[i];
+            continue;
+        }
+        switch (literal[++i]) {
+        case 'n':
+            text += '\n';
+            break;
+        case 't':
+            text += '\t';
+            break;
+        case 'r':
+            text += '\r';
+            break;
+        default:
+            text += literal[i];
+            break;
+        }
+    }
+    return text;
+}
+
+/* A JavaStaticCall the interpreter can run: the class, the method as JayInterop matches it, ignoring case, and the
+ * number of arguments after those two */
+struct BuiltinMethod {
+    std::string_view className;
+    std::string_view method;
+    size_t arity;
+    Builtin builtin;
+};
+
+static constexpr BuiltinMethod builtinMethods[] = {
+    { "java.lang.Math", "abs", 1, Builtin::ABS },
+    { "java.lang.Math", "max", 2, Builtin::MAX },
+    { "java.lang.Math", "min", 2, Builtin::MIN },
+    { "java.lang.Math", "sqrt", 1, Builtin::SQRT },
+    { "java.lang.Math", "floor", 1, Builtin::FLOOR },
+    { "java.lang.Math", "ceil", 1, Builtin::CEIL },
+    { "java.lang.Math", "rint", 1, Builtin::RINT },
+    { "java.lang.Math", "signum", 1, Builtin::SIGNUM },
+    { "java.lang.Math", "toradians", 1, Builtin::TO_RADIANS },
+    { "java.lang.Math", "todegrees", 1, Builtin::TO_DEGREES },
+    { "java.lang.StrictMath", "abs", 1, Builtin::ABS },
+    { "java.lang.StrictMath", "max", 2, Builtin::MAX },
+    { "java.lang.StrictMath", "min", 2, Builtin::MIN },
+    { "java.lang.StrictMath", "sqrt", 1, Builtin::SQRT },
+    { "java.lang.StrictMath", "floor", 1, Builtin::FLOOR },
+    { "java.lang.StrictMath", "ceil", 1, Builtin::CEIL },
+    { "java.lang.StrictMath", "rint", 1, Builtin::RINT },
+    { "java.lang.StrictMath", "signum", 1, Builtin::SIGNUM },
+    { "java.lang.String", "concat", 2, Builtin::CONCAT },
+    { "java.lang.String", "length", 1, Builtin::LENGTH },
+};
+
+/* The builtin for a JavaStaticCall; any other call needs the JVM, whose results the interpreter cannot reproduce */
+static Builtin builtinFor(const Call& call)
+{
+    const auto* className = call.args.size() >= 2 ? std::get_if<Literal>(&call.args[0]->content) : nullptr;
+    const auto* methodName = call.args.size() >= 2 ? std::get_if<Literal>(&call.args[1]->content) : nullptr;
+    if (className == nullptr || methodName == nullptr || !std::holds_alternative<std::string>(className->literal)
+        || !std::holds_alternative<std::string>(methodName->literal)) {
+        throw std::runtime_error("JavaStaticCall needs a class and method name literal");
+    }
+    const std::string cls = unquote(std::get<std::string>(className->literal));
+    std::string method = unquote(std::get<std::string>(methodName->literal));
+    const std::string name = cls + "." + method;
+    std::transform(method.begin(), method.end(), method.begin(), [](const unsigned char ch) { return std::tolower(ch); });
+    for (const auto& builtin : builtinMethods) {
+        if (builtin.className == cls && builtin.method == method && builtin.arity == call.args.size() - 2) {
+            return builtin.builtin;
+        }
+    }
+    throw std::runtime_error("--interp cannot run JavaStaticCall " + name + " with " + std::to_string(call.args.size() - 2)
+        + " arguments; build without --interp to call it on the JVM");
+}
+
+auto BytecodeCompiler::compile(const std::string& module, const std::vector<std::shared_ptr<Statement>>& statements,
+    const size_t locals) -> uint32_t
+{
+    chunk = moduleIndex(module);
+    this->locals = static_cast<uint32_t>(locals);
+    top = this->locals;
+    current().registers = this->locals;
+    line = 0;
+
+    for (const auto& stmt : statements) {
+        statement(*stmt);
+    }
+    emit(Op::RETURN);
+    return chunk;
+}
+
+auto BytecodeCompiler::moduleIndex(const std::string& module) -> uint32_t
+{
+    // Imports can be lowered before the module they name
+    const auto [it, inserted] = program.moduleIndex.emplace(module, program.modules.size());
+    if (inserted) {
+        program.modules.push_back({ module });
+    }
+    return it->second;
+}
+
+auto BytecodeCompiler::globalIndex(const std::string& module, const std::string& name) -> uint32_t
+{
+    const auto [it, inserted] = program.globalIndex.emplace(module + "." + name, program.globals.size());
+    if (inserted) {
+        program.globals.push_back(it->first);
+    }
+    return it->second;
+}
+
+auto BytecodeCompiler::constant(Constant value) -> uint32_t
+{
+    auto& constants = current().constants;
+    for (size_t i = 0; i < constants.size(); ++i) {
+        if (constants[i] == value) {
+            return static_cast<uint32_t>(i);
+        }
+    }
+    constants.push_back(std::move(value));
+    return static_cast<uint32_t>(constants.size() - 1);
+}
+
+auto BytecodeCompiler::temporary() -> uint32_t
+{
+    const uint32_t reg = top++;
+    current().registers = std::max(current().registers, top);
+    return reg;
+}
+
+auto BytecodeCompiler::emit(const Op op, const uint32_t a, const uint32_t b, const uint32_t c) -> size_t
+{
+    current().code.push_back({ op, a, b, c });
+    // Token lines count from zero
+    current().lines.push_back(line + 1);
+    return current().code.size() - 1;
+}
+
+void BytecodeCompiler::patch(const std::vector<size_t>& jumps)
+{
+    patch(jumps, static_cast<uint32_t>(current().code.size()));
+}
+
+void BytecodeCompiler::patch(const std::vector<size_t>& jumps, const uint32_t target)
+{
+    for (const size_t jump : jumps) {
+        Instruction& instruction = current().code[jump];
+        if (instruction.op == Op::JUMP) {
+            instruction.a = target;
+        } else if (instruction.op == Op::JUMPIF || instruction.op == Op::JUMPIFNOT) {
+            instruction.b = target;
+        } else {
+            instruction.c = target;
+        }
+    }
+}
+
+auto BytecodeCompiler::assigns(const Expr& expr) -> bool
+{
+    return std::visit(overloaded {
+                          [](const Assign&) { return true; },
+                          [](const Binary& b) { return assigns(*b.left) || assigns(*b.right); },
+                          [](const Logical& l) { return assigns(*l.left) || assigns(*l.right); },
+                          [](const Unary& u) { return assigns(*u.value); },
+                          [](const Grouping& g) { return assigns(*g.expression); },
+                          [](const Ternary& t) { return assigns(*t.condition) || assigns(*t.left) || assigns(*t.right); },
+                          [](const Call& c) {
+                              for (const auto& arg : c.args) {
+                                  if (assigns(*arg)) {
+                                      return true;
+                                  }
+                              }
+                              return false;
+                          },
+                          [](auto&) { return false; } },
+        expr.content);
+}
+
+void BytecodeCompiler::at(const int sourceLine)
+{
+    if (sourceLine >= 0) {
+        line = sourceLine;
+    }
+}
+
+void BytecodeCompiler::statement(const Statement& stmt)
+{
+    top = locals;
+
+    std::visit(overloaded {
+                   [&](const PrintStatement& ps) {
+                       at(ps.line);
+                       emit(Op::LOG, expression(*ps.expression));
+                   },
+                   [&](const ExprStatement& es) {
+                       at(es.line);
+                       expression(*es.expression);
+                   },
+                   [&](const JJStatement& js) {
+                       at(js.name.line);
+                       if (!js.module.empty()) {
+                           emit(Op::SETGLOBAL, globalIndex(js.module, js.name.getLexeme()), expression(*js.value));
+                           return;
+                       }
+                       if (js.slot < 0) {
+                           throw std::runtime_error("Undefined variable " + js.name.getLexeme());
+                       }
+                       expression(*js.value, static_cast<uint32_t>(js.slot));
+                   },
+                   [&](const While& w) {
+                       at(w.line);
+                       std::vector<size_t> enter;
+                       std::vector<size_t> exits;
+                       if (w.invariants.empty()) {
+                           // Test at the bottom so each iteration takes a single backward branch
+                           enter.push_back(emit(Op::JUMP));
+                       } else {
+                           // Guard the preheader so hoisted code only runs if the loop body would
+                           condition(*w.condition, false, exits);
+                           for (const auto& [expr, slot] : w.invariants) {
+                               top = locals;
+                               hoisted[expr.get()] = expression(*expr, static_cast<uint32_t>(slot));
+                           }
+                       }
+                       const auto body = static_cast<uint32_t>(current().code.size());
+                       statement(*w.body);
+
+                       top = locals;
+                       at(w.line);
+                       patch(enter);
+                       std::vector<size_t> loop;
+                       condition(*w.condition, true, loop);
+                       patch(loop, body);
+                       patch(exits);
+
+                       for (const auto& invariant : w.invariants) {
+                           hoisted.erase(invariant.expression.get());
+                       }
+                   },
+                   [&](const Block& b) {
+                       for (const auto& inner : b.statements) {
+                           statement(*inner);
+                       }
+                   },
+                   [&](const IfStatement& i) {
+                       at(i.line);
+                       std::vector<size_t> otherwise;
+                       condition(*i.condition, false, otherwise);
+                       statement(*i.ifBlock);
+                       if (i.elseBlock != nullptr) {
+                           const size_t end = emit(Op::JUMP);
+                           patch(otherwise);
+                           statement(*i.elseBlock);
+                           patch({ end });
+                       } else {
+                           patch(otherwise);
+                       }
+                   },
+                   [&](const Function&) {},
+                   [&](const Import& i) {
+                       at(i.module.line);
+                       emit(Op::IMPORT, moduleIndex(i.module.getLexeme()));
+                   },
+                   [&](auto&) {
+                       throw std::runtime_error("Unsupported statement type");
+                   } },
+        stmt.content);
+}
+
+auto BytecodeCompiler::expression(const Expr& expr, const uint32_t target) -> uint32_t
+{
+    // Into the target, or a fresh temporary
+    const auto into = [&] { return target == anywhere ? temporary() : target; };
+    // Values already in some register are copied only when a target asks for them
+    const auto place = [&](const uint32_t reg) {
+        if (target == anywhere || target == reg) {
+            return reg;
+        }
+        emit(Op::MOVE, target, reg);
+        return target;
+    };
+
+    if (auto it = hoisted.find(&expr); it != hoisted.end()) {
+        return place(it->second);
+    }
+
+    return std::visit(overloaded {
+                          [&](const Literal& l) -> uint32_t {
+                              Constant value = std::visit(overloaded {
+                                                              [](const std::string& s) -> Constant { return unquote(s); },
+                                                              [](const auto& v) -> Constant { return v; } },
+                                  l.literal);
+                              const uint32_t reg = into();
+                              emit(Op::LOADK, reg, constant(std::move(value)));
+                              return reg;
+                          },
+                          [&](const Grouping& g) {
+                              return expression(*g.expression, target);
+                          },
+                          [&](const Variable& v) -> uint32_t {
+                              if (!v.module.empty()) {
+                                  const uint32_t reg = into();
+                                  emit(Op::GETGLOBAL, reg, globalIndex(v.module, v.name.getLexeme()));
+                                  return reg;
+                              }
+                              if (v.slot < 0) {
+                                  throw std::runtime_error("Undefined variable " + v.name.getLexeme());
+                              }
+                              return place(static_cast<uint32_t>(v.slot));
+                          },
+                          [&](const Assign& a) -> uint32_t {
+                              if (!a.module.empty()) {
+                                  const uint32_t reg = expression(*a.value);
+                                  emit(Op::SETGLOBAL, globalIndex(a.module, a.name.getLexeme()), reg);
+                                  return place(reg);
+                              }
+                              return place(expression(*a.value, static_cast<uint32_t>(a.slot)));
+                          },
+                          [&](const Unary& u) -> uint32_t {
+                              const uint32_t value = expression(*u.value);
+                              const uint32_t reg = into();
+                              emit(u.opr.type == TokenType::MINUS ? Op::NEG : Op::NOT, reg, value);
+                              return reg;
+                          },
+                          [&](const Binary& b) -> uint32_t {
+                              uint32_t left = expression(*b.left);
+                              // The left operand was read before the right one could assign to it
+                              if (left < locals && assigns(*b.right)) {
+                                  const uint32_t copy = temporary();
+                                  emit(Op::MOVE, copy, left);
+                                  left = copy;
+                              }
+                              const uint32_t right = expression(*b.right);
+                              Op op;
+                              switch (b.opr.type) {
+                              case TokenType::PLUS:
+                                  op = Op::ADD;
+                                  break;
+                              case TokenType::MINUS:
+                                  op = Op::SUB;
+                                  break;
+                              case TokenType::STAR:
+                                  op = Op::MUL;
+                                  break;
+                              case TokenType::SLASH:
+                                  op = Op::DIV;
+                                  break;
+                              case TokenType::EQUAL_EQUAL:
+                                  op = Op::EQ;
+                                  break;
+                              case TokenType::BANG_EQUAL:
+                                  op = Op::NE;
+                                  break;
+                              case TokenType::LESS:
+                                  op = Op::LT;
+                                  break;
+                              case TokenType::LESS_EQUAL:
+                                  op = Op::LE;
+                                  break;
+                              case TokenType::GREATER:
+                                  op = Op::GT;
+                                  break;
+                              case TokenType::GREATER_EQUAL:
+                                  op = Op::GE;
+                                  break;
+                              default:
+                                  throw std::runtime_error("Unexpected binary operator");
+                              }
+                              const uint32_t reg = into();
+                              emit(op, reg, left, right);
+                              return reg;
+                          },
+                          [&](const Logical& l) -> uint32_t {
+                              // Built in a temporary: the right operand may read the target's old value
+                              const uint32_t reg = temporary();
+                              expression(*l.left, reg);
+                              const size_t skip = emit(l.token.type == TokenType::AND ? Op::JUMPIFNOT : Op::JUMPIF, reg);
+                              expression(*l.right, reg);
+                              patch({ skip });
+                              return place(reg);
+                          },
+                          [&](const Ternary& t) -> uint32_t {
+                              const uint32_t reg = temporary();
+                              std::vector<size_t> otherwise;
+                              condition(*t.condition, false, otherwise);
+                              expression(*t.left, reg);
+                              const size_t end = emit(Op::JUMP);
+                              patch(otherwise);
+                              expression(*t.right, reg);
+                              patch({ end });
+                              return place(reg);
+                          },
+                          [&](const Call& c) -> uint32_t {
+                              const auto* callee = std::get_if<Variable>(&c.callee->content);
+                              if (callee && callee->name.getLexeme() == "JavaStaticCall") {
+                                  const Builtin builtin = builtinFor(c);
+                                  // Arguments go to consecutive registers, claimed before any of them is evaluated
+                                  const uint32_t first = top;
+                                  for (size_t i = 2; i < c.args.size(); ++i) {
+                                      temporary();
+                                  }
+                                  for (size_t i = 2; i < c.args.size(); ++i) {
+                                      expression(*c.args[i], first + static_cast<uint32_t>(i - 2));
+                                  }
+                                  const uint32_t reg = into();
+                                  emit(Op::CALL, reg, static_cast<uint32_t>(builtin), first);
+                                  return reg;
+                              }
+                              if (callee && callee->name.getLexeme() == "flush") {
+                                  if (!c.args.empty()) {
+                                      throw std::runtime_error("flush takes no arguments");
+                                  }
+                                  emit(Op::FLUSH);
+                                  const uint32_t reg = into();
+                                  emit(Op::LOADK, reg, constant(nullptr));
+                                  return reg;
+                              }
+                              throw std::runtime_error("Only JavaStaticCall and flush can be called");
+                          } },
+        expr.content);
+}
+
+void BytecodeCompiler::condition(const Expr& expr, const bool jumpIfTrue, std::vector<size_t>& exits)
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        condition(*g->expression, jumpIfTrue, exits);
+        return;
+    }
+
+    if (const auto* l = std::get_if<Literal>(&expr.content)) {
+        // Constant condition: either always jump or always fall through
+        const bool truthy = !std::holds_alternative<std::nullptr_t>(l->literal)
+            && !(std::holds_alternative<bool>(l->literal) && !std::get<bool>(l->literal));
+        if (truthy == jumpIfTrue) {
+            exits.push_back(emit(Op::JUMP));
+        }
+        return;
+    }
+
+    if (const auto* u = std::get_if<Unary>(&expr.content); u != nullptr && u->opr.type == TokenType::BANG) {
+        condition(*u->value, !jumpIfTrue, exits);
+        return;
+    }
+
+    if (const auto* l = std::get_if<Logical>(&expr.content)) {
+        const bool isAnd = l->token.type == TokenType::AND;
+        if (isAnd != jumpIfTrue) {
+            // and -> false / or -> true: either operand alone decides the jump
+            condition(*l->left, jumpIfTrue, exits);
+            condition(*l->right, jumpIfTrue, exits);
+        } else {
+            std::vector<size_t> skip;
+            condition(*l->left, !jumpIfTrue, skip);
+            condition(*l->right, jumpIfTrue, exits);
+            patch(skip);
+        }
+        return;
+    }
+
+    if (const auto* b = std::get_if<Binary>(&expr.content)) {
+        Op whenTrue = Op::COUNT;
+        Op whenFalse = Op::COUNT;
+        switch (b->opr.type) {
+        case TokenType::GREATER:
+            whenTrue = Op::JUMPGT;
+            whenFalse = Op::JUMPLE;
+            break;
+        case TokenType::GREATER_EQUAL:
+            whenTrue = Op::JUMPGE;
+            whenFalse = Op::JUMPLT;
+            break;
+        case TokenType::LESS:
+            whenTrue = Op::JUMPLT;
+            whenFalse = Op::JUMPGE;
+            break;
+        case TokenType::LESS_EQUAL:
+            whenTrue = Op::JUMPLE;
+            whenFalse = Op::JUMPGT;
+            break;
+        case TokenType::EQUAL_EQUAL:
+            whenTrue = Op::JUMPEQ;
+            whenFalse = Op::JUMPNE;
+            break;
+        case TokenType::BANG_EQUAL:
+            whenTrue = Op::JUMPNE;
+            whenFalse = Op::JUMPEQ;
+            break;
+        default:
+            break;
+        }
+
+        if (whenTrue != Op::COUNT) {
+            uint32_t left = expression(*b->left);
+            if (left < locals && assigns(*b->right)) {
+                const uint32_t copy = temporary();
+                emit(Op::MOVE, copy, left);
+                left = copy;
+            }
+            const uint32_t right = expression(*b->right);
+            exits.push_back(emit(jumpIfTrue ? whenTrue : whenFalse, left, right));
+            return;
+        }
+    }
+
+    exits.push_back(emit(jumpIfTrue ? Op::JUMPIF : Op::JUMPIFNOT, expression(expr)));
+}
@@ -1,25 +1,52 @@
 #include "Compiler.h"
 #include "AssemblyInfo.h"
-#include "Environment.h"
 #include "Expression.h"
+#include "LoopInvariants.h"
 #include "Statement.h"
 #include "statementTypes.h"
+#include <climits>
+#include <cmath>
+#include <charconv>
 #include <cstddef>
 #include <memory>
 #include <stdexcept>
 #include <string>
+/* Placeholders in relocatable code: a marker byte, the compiler-local index, then the terminator */
+static constexpr char labelMarker = '\x01';
+static constexpr char placeholderEnd = '\x02';
+static constexpr char constantMarker = '\x03';
+static constexpr char counterMarker = '\x04';
+static constexpr const char* markers = "\x01\x02\x03\x04";
+
+static std::string placeholder(const char marker, const size_t index)
+{
+    return marker + std::to_string(index) + placeholderEnd;
+}
+
 AssemblyInfo Compiler::JavaStaticCall(const std::vector<std::shared_ptr<Expr>>& args)
 {
     AssemblyInfo info;
+    info.type = AssemblyInfo::Type::OBJECT;
     if (args.size() < 2) {
         throw std::runtime_error("JavaStaticCall requires at least class name and method name");
     }
     auto classNameExpr = std::get<std::string>(std::get<Literal>(args[0]->content).literal);
     auto methodNameExpr = std::get<std::string>(std::get<Literal>(args[1]->content).literal);
+    // String literals keep their quotes
+    javaTargets[classNameExpr.substr(1, classNameExpr.size() - 2)].insert(methodNameExpr.substr(1, methodNameExpr.size() - 2));
+
+    size_t site = 0;
+    if (profile) {
+        site = addProfileSite("call", currentLine,
+            classNameExpr.substr(1, classNameExpr.size() - 2) + "." + methodNameExpr.substr(1, methodNameExpr.size() - 2));
+        emitProfileCount(info.code, site);
+        // The start time stays on the stack beneath the call
+        emitInstruction(info.code, "invokestatic Method java/lang/System nanoTime ()J");
+    }
 
     // Generate the invokedynamic setup
     emitInstruction(info.code, "invokestatic Method java/lang/invoke/MethodHandles lookup ()Ljava/lang/invoke/MethodHandles$Lookup;");
-    emitInstruction(info.code, "ldc " + methodNameExpr);
+    emitInstruction(info.code, "ldc " + literalText(methodNameExpr));
     emitInstruction(info.code, "ldc Class java/lang/Object");
 
     // Create array of parameter types
@@ -45,15 +72,11 @@ AssemblyInfo Compiler::JavaStaticCall(const std::vector<std::shared_ptr<Expr>>&
         emitInstruction(info.code, "invokestatic Method java/lang/invoke/MethodType methodType (Ljava/lang/Class;Ljava/lang/Class;[Ljava/lang/Class;)Ljava/lang/invoke/MethodType;");
     }
 
-    emitInstruction(info.code, "ldc " + classNameExpr);
-    emitInstruction(info.code, "ldc " + methodNameExpr);
+    emitInstruction(info.code, "ldc " + literalText(classNameExpr));
+    emitInstruction(info.code, "ldc " + literalText(methodNameExpr));
     emitInstruction(info.code, "invokestatic Method Interop/JayInterop bootstrap (Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/String;Ljava/lang/invoke/MethodType;Ljava/lang/String;Ljava/lang/String;)Ljava/lang/invoke/CallSite;");
 
-    // Store the CallSite
-    emitInstruction(info.code, "astore_3");
-
-    // Load the CallSite and get its dynamicInvoker
-    emitInstruction(info.code, "aload_3");
+    // Get the CallSite's dynamicInvoker
     emitInstruction(info.code, "invokevirtual Method java/lang/invoke/CallSite dynamicInvoker ()Ljava/lang/invoke/MethodHandle;");
 
     // Load the arguments
@@ -72,13 +95,285 @@ AssemblyInfo Compiler::JavaStaticCall(const std::vector<std::shared_ptr<Expr>>&
 
     emitInstruction(info.code, "invokestatic Method Types/JayObject generateObject (Ljava/lang/Object;)LTypes/JayObject;");
 
+    if (profile) {
+        // result, start -> result, now - start, then add that to the site's nanoTime slot
+        emitInstruction(info.code, "dup_x2");
+        emitInstruction(info.code, "pop");
+        emitInstruction(info.code, "invokestatic Method java/lang/System nanoTime ()J");
+        emitInstruction(info.code, "lsub");
+        emitInstruction(info.code, "lneg");
+        emitInstruction(info.code, "getstatic " + className + "/$profile [J");
+        emitInstruction(info.code, "ldc " + counterIndex(2 * site + 1));
+        emitInstruction(info.code, "dup2_x2");
+        emitInstruction(info.code, "laload");
+        emitInstruction(info.code, "ladd");
+        emitInstruction(info.code, "lastore");
+    }
     return info;
 }
+std::string Compiler::constantField(const std::string& key, const std::string& loadCode)
+{
+    auto it = constants.find(key);
+    if (it != constants.end()) {
+        return it->second;
+    }
+
+    if (relocatable) {
+        std::string name = placeholder(constantMarker, constants.size());
+        constants.emplace(key, name);
+        constantOrder.emplace_back(key, loadCode);
+        return name;
+    }
+
+    std::string name = "lit" + std::to_string(constants.size());
+    constants.emplace(key, name);
+    constantFields += ".field private static final " + name + " LTypes/JayObject;\n";
+    constantInitializer += loadCode;
+    emitInstruction(constantInitializer, "putstatic " + className + "/" + name + " LTypes/JayObject;");
+    return name;
+}
+
+auto Compiler::addProfileSite(const std::string& kind, const int line, const std::string& description) -> size_t
+{
+    // The site table is a string constant split on these
+    std::string text;
+    for (const char c : description) {
+        text += (c == '"' || c == '\\' || c == '|' || c == ';' || static_cast<unsigned char>(c) < 0x20) ? '?' : c;
+    }
+    profileSites.push_back({ kind, line, text });
+    return profileSites.size() - 1;
+}
+
+void Compiler::emitProfileCount(std::string& code, const size_t site)
+{
+    emitInstruction(code, "getstatic " + className + "/$profile [J");
+    emitInstruction(code, "ldc " + counterIndex(2 * site));
+    emitInstruction(code, "dup2");
+    emitInstruction(code, "laload");
+    emitInstruction(code, "lconst_1");
+    emitInstruction(code, "ladd");
+    emitInstruction(code, "lastore");
+}
+
+void Compiler::generateProfileTable(const std::string& source)
+{
+    if (!profile) {
+        return;
+    }
+    std::string table = source;
+    for (const auto& site : profileSites) {
+        // Token lines count from zero
+        table += ";" + site.kind + "|" + (site.line < 0 ? "?" : std::to_string(site.line + 1)) + "|" + site.description;
+    }
+
+    // A string constant holds at most 64 KiB, so long tables are concatenated at class initialisation
+    constexpr size_t chunkSize = 60000;
+    constantFields += ".field private static final $profile [J\n";
+    for (size_t i = 0; i < table.size(); i += chunkSize) {
+        emitInstruction(constantInitializer, "ldc \"" + table.substr(i, chunkSize) + "\"");
+        if (i > 0) {
+            emitInstruction(constantInitializer, "invokevirtual Method java/lang/String concat (Ljava/lang/String;)Ljava/lang/String;");
+        }
+    }
+    emitInstruction(constantInitializer, "invokestatic Method Runtime/JayProfile counters (Ljava/lang/String;)[J");
+    emitInstruction(constantInitializer, "putstatic " + className + "/$profile [J");
+}
+
+auto Compiler::predictType(const Expr& expr, const std::vector<AssemblyInfo::Type>& types) -> AssemblyInfo::Type
+{
+    using Type = AssemblyInfo::Type;
+    return std::visit(overloaded {
+                          [](const Literal& l) {
+                              return std::visit(overloaded {
+                                                    [](const double&) { return Type::DECIMAL; },
+                                                    [](const std::string&) { return Type::STRING; },
+                                                    [](const bool&) { return Type::BOOL; },
+                                                    [](const auto&) { return Type::NULL_T; } },
+                                  l.literal);
+                          },
+                          [&](const Grouping& g) { return predictType(*g.expression, types); },
+                          [&](const Variable& v) {
+                              return v.module.empty() && v.slot >= 0 && static_cast<size_t>(v.slot) < types.size() ? types[v.slot] : Type::OBJECT;
+                          },
+                          [&](const Assign& a) { return predictType(*a.value, types); },
+                          [&](const Unary& u) { return u.opr.type == TokenType::BANG ? Type::BOOL : predictType(*u.value, types); },
+                          [&](const Binary& b) {
+                              switch (b.opr.type) {
+                              case TokenType::PLUS:
+                                  return predictType(*b.left, types) == Type::DECIMAL && predictType(*b.right, types) == Type::DECIMAL
+                                      ? Type::DECIMAL
+                                      : Type::STRING;
+                              case TokenType::MINUS:
+                              case TokenType::STAR:
+                              case TokenType::SLASH:
+                                  return Type::DECIMAL;
+                              default:
+                                  return Type::BOOL;
+                              }
+                          },
+                          [&](const Ternary& t) {
+                              const auto left = predictType(*t.left, types);
+                              return left == predictType(*t.right, types) ? left : Type::OBJECT;
+                          },
+                          [&](const Logical& l) {
+                              const auto left = predictType(*l.left, types);
+                              return left == predictType(*l.right, types) ? left : Type::OBJECT;
+                          },
+                          [](const auto&) { return Type::OBJECT; } },
+        expr.content);
+}
+
+void Compiler::predictVariableTypes(const Statement& stmt, std::vector<AssemblyInfo::Type>& types)
+{
+    // Only a guess: the types a statement really reads are checked by agreesWith()
+    const auto store = [&](const int slot, const std::shared_ptr<Expr>& value) {
+        if (slot < 0) {
+            return;
+        }
+        if (static_cast<size_t>(slot) >= types.size()) {
+            types.resize(slot + 1, AssemblyInfo::Type::OBJECT);
+        }
+        types[slot] = predictType(*value, types);
+    };
+    std::visit(overloaded {
+                   [&](const ExprStatement& es) {
+                       if (const auto* a = std::get_if<Assign>(&es.expression->content); a != nullptr && a->module.empty()) {
+                           store(a->slot, a->value);
+                       }
+                   },
+                   [&](const JJStatement& js) {
+                       if (js.module.empty()) {
+                           store(js.slot, js.value);
+                       }
+                   },
+                   [&](const Block& b) {
+                       for (const auto& inner : b.statements) {
+                           predictVariableTypes(*inner, types);
+                       }
+                   },
+                   [&](const IfStatement& i) {
+                       predictVariableTypes(*i.ifBlock, types);
+                       if (i.elseBlock != nullptr) {
+                           predictVariableTypes(*i.elseBlock, types);
+                       }
+                   },
+                   [&](const While& w) { predictVariableTypes(*w.body, types); },
+                   [](const auto&) {} },
+        stmt.content);
+}
+
+void Compiler::assumeVariableTypes(std::vector<AssemblyInfo::Type> types)
+{
+    slotTypes = std::move(types);
+}
+
+auto Compiler::agreesWith(const Compiler& fragment) const -> bool
+{
+    if (fragment.placeholderText) {
+        return false;
+    }
+    for (const auto& [slot, type] : fragment.assumedTypes) {
+        const auto actual = static_cast<size_t>(slot) < slotTypes.size() ? slotTypes[slot] : AssemblyInfo::Type::OBJECT;
+        if (actual != type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto Compiler::absorb(const Compiler& fragment, const std::string& code) -> std::string
+{
+    std::vector<std::string> names;
+    for (const auto& [key, loadCode] : fragment.constantOrder) {
+        names.push_back(constantField(key, loadCode));
+    }
+    const size_t labelBase = labelCounter;
+    const size_t counterBase = 2 * profileSites.size();
+
+    const auto relocate = [&](const std::string& text) {
+        std::string out;
+        out.reserve(text.size());
+        size_t position = 0;
+        for (size_t marker; (marker = text.find_first_of(markers, position)) != std::string::npos;) {
+            out.append(text, position, marker - position);
+            const size_t end = text.find(placeholderEnd, marker);
+            size_t index = 0;
+            std::from_chars(text.data() + marker + 1, text.data() + end, index);
+            switch (text[marker]) {
+            case labelMarker:
+                out += "L" + std::to_string(labelBase + index);
+                break;
+            case constantMarker:
+                out += names[index];
+                break;
+            default:
+                out += std::to_string(counterBase + index);
+                break;
+            }
+            position = end + 1;
+        }
+        out.append(text, position);
+        return out;
+    };
+
+    labelCounter += fragment.labelCounter;
+    lineNumberTable += relocate(fragment.lineNumberTable);
+    localVariableTable += relocate(fragment.localVariableTable);
+    for (const auto& variable : fragment.scopes.front()) {
+        scopes.front().push_back({ variable.slot, variable.name, relocate(variable.start) });
+    }
+    globalFields += fragment.globalFields;
+    for (const auto& [target, methods] : fragment.javaTargets) {
+        javaTargets[target].insert(methods.begin(), methods.end());
+    }
+    profileSites.insert(profileSites.end(), fragment.profileSites.begin(), fragment.profileSites.end());
+    for (const int slot : fragment.storedSlots) {
+        setSlotType(slot, fragment.slotTypes[slot]);
+    }
+    return relocate(code);
+}
+
+void Compiler::setSlotType(const int slot, const AssemblyInfo::Type type)
+{
+    if (relocatable) {
+        storedSlots.insert(slot);
+    }
+    if (static_cast<size_t>(slot) >= slotTypes.size()) {
+        slotTypes.resize(slot + 1, AssemblyInfo::Type::OBJECT);
+    }
+    slotTypes[slot] = type;
+}
+
+auto Compiler::slotType(const int slot) -> AssemblyInfo::Type
+{
+    const auto type = static_cast<size_t>(slot) < slotTypes.size() ? slotTypes[slot] : AssemblyInfo::Type::OBJECT;
+    if (relocatable && storedSlots.count(slot) == 0) {
+        assumedTypes.emplace(slot, type);
+    }
+    return type;
+}
+
 std::string Compiler::generateLabel()
 {
+    if (relocatable) {
+        return placeholder(labelMarker, labelCounter++);
+    }
     return "L" + std::to_string(labelCounter++);
 }
 
+auto Compiler::counterIndex(const size_t index) const -> std::string
+{
+    return relocatable ? placeholder(counterMarker, index) : std::to_string(index);
+}
+
+auto Compiler::literalText(const std::string& text) -> std::string
+{
+    if (relocatable && text.find_first_of(markers) != std::string::npos) {
+        placeholderText = true;
+    }
+    return text;
+}
+
 void Compiler::emitLabel(std::string& code, const std::string& label)
 {
     code += label + ":\n";
@@ -100,8 +395,103 @@ void Compiler::emitMethodCall(std::string& code, const std::string& className, c
     code += (isStatic ? "invokestatic " : "invokevirtual ") + className + "/" + methodName + descriptor + "\n";
 }
 
+auto Compiler::isString(const Expr& expr) -> bool
+{
+    return std::visit(overloaded {
+                          [](const Literal& l) { return std::holds_alternative<std::string>(l.literal); },
+                          [](const Grouping& g) { return isString(*g.expression); },
+                          [](const Binary& b) { return b.opr.type == TokenType::PLUS && (isString(*b.left) || isString(*b.right)); },
+                          [](const auto&) { return false; } },
+        expr.content);
+}
+
+auto Compiler::isNumber(const Expr& expr) -> bool
+{
+    return std::visit(overloaded {
+                          [](const Literal& l) { return std::holds_alternative<double>(l.literal); },
+                          [](const Grouping& g) { return isNumber(*g.expression); },
+                          [](const Unary& u) { return u.opr.type == TokenType::MINUS && isNumber(*u.value); },
+                          [](const Binary& b) {
+                              const auto opr = b.opr.type;
+                              return (opr == TokenType::PLUS || opr == TokenType::MINUS || opr == TokenType::STAR || opr == TokenType::SLASH)
+                                  && isNumber(*b.left) && isNumber(*b.right);
+                          },
+                          [](const auto&) { return false; } },
+        expr.content);
+}
+
+auto Compiler::generateConcatenation(const Binary& b) -> std::optional<AssemblyInfo>
+{
+    // a + b + c parses as ((a + b) + c): walk down the left operands, stopping at hoisted values
+    std::vector<const Binary*> spine { &b };
+    while (true) {
+        const auto& left = spine.back()->left;
+        const auto* next = std::get_if<Binary>(&left->content);
+        if (next == nullptr || next->opr.type != TokenType::PLUS || hoisted.count(left.get()) != 0) {
+            break;
+        }
+        spine.push_back(next);
+    }
+    std::vector<const Expr*> operands { spine.back()->left.get() };
+    for (auto it = spine.rbegin(); it != spine.rend(); ++it) {
+        operands.push_back((*it)->right.get());
+    }
+
+    // Once one side is a string, + appends toString() of the other, as JayString.add and JayNumber.add do
+    size_t first = 0;
+    while (first < operands.size() && !isString(*operands[first])) {
+        ++first;
+    }
+    if (first == operands.size()) {
+        return std::nullopt;
+    }
+    // The operands before the first string are added as usual; a number sum concatenates the same way,
+    // anything else still goes through add, which rejects booleans and nil
+    std::vector<const Expr*> parts;
+    const Binary* head = nullptr;
+    const Expr* prefix = first > 0 ? spine[spine.size() - first]->left.get() : nullptr;
+    if (prefix == nullptr) {
+        parts.assign(operands.begin(), operands.end());
+    } else if (isNumber(*prefix)) {
+        parts.push_back(prefix);
+        parts.insert(parts.end(), operands.begin() + first, operands.end());
+    } else {
+        head = spine[spine.size() - first];
+        parts.push_back(nullptr);
+        parts.insert(parts.end(), operands.begin() + first + 1, operands.end());
+    }
+    if (parts.size() < 3) {
+        return std::nullopt;
+    }
+
+    AssemblyInfo info;
+    emitInstruction(info.code, "new java/lang/StringBuilder");
+    emitInstruction(info.code, "dup");
+    emitInstruction(info.code, "invokespecial java/lang/StringBuilder/<init>()V");
+    for (const Expr* part : parts) {
+        const auto* literal = part != nullptr ? std::get_if<Literal>(&part->content) : nullptr;
+        if (literal != nullptr && std::holds_alternative<std::string>(literal->literal)) {
+            emitInstruction(info.code, "ldc " + literalText(std::get<std::string>(literal->literal)));
+            emitMethodCall(info.code, "java/lang/StringBuilder", "append", "(Ljava/lang/String;)Ljava/lang/StringBuilder;", false);
+            continue;
+        }
+        info.code += part != nullptr ? generateAssembly(*part).code : generateBytecode(*head).code;
+        emitMethodCall(info.code, "java/lang/StringBuilder", "append", "(Ljava/lang/Object;)Ljava/lang/StringBuilder;", false);
+    }
+    emitMethodCall(info.code, "java/lang/StringBuilder", "toString", "()Ljava/lang/String;", false);
+    emitMethodCall(info.code, "Types/JayObject", "generateObject", "(Ljava/lang/String;)LTypes/JayObject;", true);
+    info.type = AssemblyInfo::Type::STRING;
+    return info;
+}
+
 auto Compiler::generateBytecode(const Binary& b) -> AssemblyInfo
 {
+    if (b.opr.type == TokenType::PLUS) {
+        if (auto concatenation = generateConcatenation(b)) {
+            return *concatenation;
+        }
+    }
+
     AssemblyInfo info;
     auto leftInfo = generateAssembly(*b.left);
     auto rightInfo = generateAssembly(*b.right);
@@ -124,6 +514,14 @@ auto Compiler::generateBytecode(const Binary& b) -> AssemblyInfo
         emitMethodCall(info.code, "Types/JayObject", "lessThanEqual", "(LTypes/JayObject;)Z", false);
         info.type = AssemblyInfo::Type::BOOL;
         break;
+    case TokenType::EQUAL_EQUAL:
+        emitMethodCall(info.code, "Types/JayObject", "equal", "(LTypes/JayObject;)Z", false);
+        info.type = AssemblyInfo::Type::BOOL;
+        break;
+    case TokenType::BANG_EQUAL:
+        emitMethodCall(info.code, "Types/JayObject", "notEqual", "(LTypes/JayObject;)Z", false);
+        info.type = AssemblyInfo::Type::BOOL;
+        break;
     case TokenType::MINUS:
         emitMethodCall(info.code, "Types/JayObject", "subtract", "(LTypes/JayObject;)LTypes/JayObject;", false);
         info.type = AssemblyInfo::Type::DECIMAL;
@@ -148,6 +546,10 @@ auto Compiler::generateBytecode(const Binary& b) -> AssemblyInfo
     default:
         throw std::runtime_error("Unexpected binary operator");
     }
+    if (info.type == AssemblyInfo::Type::BOOL) {
+        // Branches test comparisons in generateCondition; as a value the result has to be a JayObject
+        emitMethodCall(info.code, "Types/JayObject", "generateObject", "(Z)LTypes/JayObject;", true);
+    }
     return info;
 }
 
@@ -161,6 +563,7 @@ auto Compiler::generateBytecode(const Unary& u) -> AssemblyInfo
         break;
     case TokenType::BANG:
         emitMethodCall(info.code, "Types/JayObject", "not", "()Z", false);
+        emitMethodCall(info.code, "Types/JayObject", "generateObject", "(Z)LTypes/JayObject;", true);
         info.type = AssemblyInfo::Type::BOOL;
         break;
     default:
@@ -169,73 +572,549 @@ auto Compiler::generateBytecode(const Unary& u) -> AssemblyInfo
     return info;
 }
 
-auto Compiler::generateLocalVariables(AssemblyInfo& info, [[maybe_unused]] Environment* environment) const -> void
+auto Compiler::generateBytecode(const Logical& l) -> AssemblyInfo
 {
+    if (isBoolean(*l.left) && isBoolean(*l.right)) {
+        // The result is whichever boolean decided, so branch on the raw comparisons and load the matching constant
+        AssemblyInfo info;
+        std::string falseLabel = generateLabel();
+        std::string endLabel = generateLabel();
+        if (l.token.type == TokenType::AND) {
+            generateCondition(info, *l.left, falseLabel, false);
+            generateCondition(info, *l.right, falseLabel, false);
+        } else {
+            std::string trueLabel = generateLabel();
+            generateCondition(info, *l.left, trueLabel, true);
+            generateCondition(info, *l.right, falseLabel, false);
+            emitLabel(info.code, trueLabel);
+        }
+        emitInstruction(info.code, "getstatic Types/JayBool/TRUE LTypes/JayBool;");
+        emitJump(info.code, "goto", endLabel);
+        emitLabel(info.code, falseLabel);
+        emitInstruction(info.code, "getstatic Types/JayBool/FALSE LTypes/JayBool;");
+        emitLabel(info.code, endLabel);
+        info.type = AssemblyInfo::Type::BOOL;
+        return info;
+    }
+
+    AssemblyInfo info = generateAssembly(*l.left);
+    std::string endLabel = generateLabel();
+
+    // Keep the left operand as the result when it already decides the outcome
+    emitInstruction(info.code, "dup");
+    emitMethodCall(info.code, "Types/JayObject", "isTruthy", "()Z", false);
+    switch (l.token.type) {
+    case TokenType::AND:
+        emitJump(info.code, "ifeq", endLabel);
+        break;
+    case TokenType::OR:
+        emitJump(info.code, "ifne", endLabel);
+        break;
+    default:
+        throw std::runtime_error("Unexpected logical operator");
+    }
+
+    emitInstruction(info.code, "pop");
+    auto rightInfo = generateAssembly(*l.right);
+    info.code += rightInfo.code;
+    emitLabel(info.code, endLabel);
+
+    if (info.type != rightInfo.type) {
+        info.type = AssemblyInfo::Type::OBJECT;
+    }
+    return info;
+}
+
+auto Compiler::generateBytecode(const Ternary& t) -> AssemblyInfo
+{
+    AssemblyInfo info;
+    std::string elseLabel = generateLabel();
+    std::string endLabel = generateLabel();
+
+    generateCondition(info, *t.condition, elseLabel, false);
+
+    auto leftInfo = generateAssembly(*t.left);
+    info.code += leftInfo.code;
+    emitJump(info.code, "goto", endLabel);
+
+    emitLabel(info.code, elseLabel);
+    auto rightInfo = generateAssembly(*t.right);
+    info.code += rightInfo.code;
+    emitLabel(info.code, endLabel);
+
+    info.type = leftInfo.type == rightInfo.type ? leftInfo.type : AssemblyInfo::Type::OBJECT;
+    return info;
+}
+
+auto Compiler::generateLocalVariables(AssemblyInfo& info) const -> void
+{
+    // Top-level variables stay in scope until run() returns
+    info.code += "Lreturn:\n";
     info.code += "return\n";
+    info.code += ".linenumbertable\n";
+    info.code += lineNumberTable;
+    info.code += ".end linenumbertable\n";
     info.code += ".localvariabletable\n";
-    // info.code += this->localVariableTable;
+    info.code += localVariableTable;
+    for (const auto& variable : scopes.front()) {
+        info.code += std::to_string(variable.slot) + " is " + variable.name + " LTypes/JayObject; from " + variable.start + " to Lreturn\n";
+    }
     info.code += ".end localvariabletable\n";
 }
 
+void Compiler::closeScope(const std::string& endLabel)
+{
+    for (const auto& variable : scopes.back()) {
+        localVariableTable += std::to_string(variable.slot) + " is " + variable.name + " LTypes/JayObject; from " + variable.start + " to " + endLabel + "\n";
+    }
+    scopes.pop_back();
+}
+
+void Compiler::markLine(std::string& code, const int line)
+{
+    const std::string label = generateLabel();
+    emitLabel(code, label);
+    // Token lines count from zero, class file lines from one
+    lineNumberTable += label + " " + std::to_string(line + 1) + "\n";
+}
+
+auto Compiler::generateCondition(AssemblyInfo& info, const Expr& condition, const std::string& label, const bool jumpIfTrue) -> void
+{
+    if (const auto* g = std::get_if<Grouping>(&condition.content)) {
+        generateCondition(info, *g->expression, label, jumpIfTrue);
+        return;
+    }
+
+    if (std::holds_alternative<Literal>(condition.content)) {
+        // Constant condition: either always jump or always fall through
+        if (isTruthy(condition) == jumpIfTrue) {
+            emitJump(info.code, "goto", label);
+        }
+        return;
+    }
+
+    if (const auto* u = std::get_if<Unary>(&condition.content); u != nullptr && u->opr.type == TokenType::BANG) {
+        generateCondition(info, *u->value, label, !jumpIfTrue);
+        return;
+    }
+
+    if (const auto* l = std::get_if<Logical>(&condition.content)) {
+        const bool isAnd = l->token.type == TokenType::AND;
+        if (isAnd != jumpIfTrue) {
+            // and -> false / or -> true: either operand alone decides the jump
+            generateCondition(info, *l->left, label, jumpIfTrue);
+            generateCondition(info, *l->right, label, jumpIfTrue);
+        } else {
+            std::string skipLabel = generateLabel();
+            generateCondition(info, *l->left, skipLabel, !jumpIfTrue);
+            generateCondition(info, *l->right, label, jumpIfTrue);
+            emitLabel(info.code, skipLabel);
+        }
+        return;
+    }
+
+    if (const auto* b = std::get_if<Binary>(&condition.content)) {
+        std::string trueJump;
+        std::string falseJump;
+        bool isComparison = true;
+        switch (b->opr.type) {
+        case TokenType::GREATER:
+            trueJump = "ifgt";
+            falseJump = "ifle";
+            break;
+        case TokenType::GREATER_EQUAL:
+            trueJump = "ifge";
+            falseJump = "iflt";
+            break;
+        case TokenType::LESS:
+            trueJump = "iflt";
+            falseJump = "ifge";
+            break;
+        case TokenType::LESS_EQUAL:
+            trueJump = "ifle";
+            falseJump = "ifgt";
+            break;
+        case TokenType::EQUAL_EQUAL:
+            isComparison = false;
+            trueJump = "ifne";
+            falseJump = "ifeq";
+            break;
+        case TokenType::BANG_EQUAL:
+            isComparison = false;
+            trueJump = "ifeq";
+            falseJump = "ifne";
+            break;
+        default:
+            break;
+        }
+
+        if (!trueJump.empty()) {
+            info.code += generateAssembly(*b->left).code;
+            info.code += generateAssembly(*b->right).code;
+            if (isComparison) {
+                emitMethodCall(info.code, "Types/JayObject", "compareTo", "(LTypes/JayObject;)I", false);
+            } else {
+                emitMethodCall(info.code, "Types/JayObject", "equal", "(LTypes/JayObject;)Z", false);
+            }
+            emitJump(info.code, jumpIfTrue ? trueJump : falseJump, label);
+            return;
+        }
+    }
+
+    info.code += generateAssembly(condition).code;
+    emitMethodCall(info.code, "Types/JayObject", "isTruthy", "()Z", false);
+    emitJump(info.code, jumpIfTrue ? "ifne" : "ifeq", label);
+}
+
 auto Compiler::generateWhileStatement(const While& w) -> AssemblyInfo
 {
     AssemblyInfo info;
+    std::string bodyLabel = generateLabel();
     std::string conditionLabel = generateLabel();
     std::string endLabel = generateLabel();
 
+    if (w.invariants.empty()) {
+        // Test at the bottom so each iteration takes a single backward branch
+        emitJump(info.code, "goto", conditionLabel);
+    } else {
+        // Guard the preheader so hoisted code only runs if the loop body would
+        generateCondition(info, *w.condition, endLabel, false);
+        for (const auto& [expr, slot] : w.invariants) {
+            auto exprInfo = generateAssembly(*expr);
+            info.code += exprInfo.code;
+            emitInstruction(info.code, "astore " + std::to_string(slot));
+            hoisted[expr.get()] = { static_cast<size_t>(slot), exprInfo.type };
+        }
+    }
+    emitLabel(info.code, bodyLabel);
+    if (profile) {
+        emitProfileCount(info.code, addProfileSite("loop", w.line < 0 ? currentLine : w.line, "while iteration"));
+    }
+
+    auto bodyInfo = generateAssembly(*w.body);
+    info.code += bodyInfo.code;
+
     emitLabel(info.code, conditionLabel);
+    if (w.line >= 0) {
+        markLine(info.code, w.line);
+    }
+    generateCondition(info, *w.condition, bodyLabel, true);
+    emitLabel(info.code, endLabel);
+
+    for (const auto& hoistedExpr : w.invariants) {
+        hoisted.erase(hoistedExpr.expression.get());
+    }
+    return info;
+}
+
+/* Integral literals up to 2^53, where the double holding them is exact */
+static std::optional<long long> integralLiteral(const Expr& expr)
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return integralLiteral(*g->expression);
+    }
+    if (const auto* u = std::get_if<Unary>(&expr.content); u != nullptr && u->opr.type == TokenType::MINUS) {
+        const auto value = integralLiteral(*u->value);
+        return value ? std::optional<long long>(-*value) : std::nullopt;
+    }
+    const auto* l = std::get_if<Literal>(&expr.content);
+    if (l == nullptr || !std::holds_alternative<double>(l->literal)) {
+        return std::nullopt;
+    }
+    const double d = std::get<double>(l->literal);
+    if (std::floor(d) != d || std::fabs(d) > 9007199254740992.0) {
+        return std::nullopt;
+    }
+    return static_cast<long long>(d);
+}
 
-    auto condInfo = generateAssembly(*w.condition);
-    info.code += condInfo.code;
+static bool isLocal(const Expr& expr, const int slot)
+{
+    const auto* v = std::get_if<Variable>(&expr.content);
+    return v != nullptr && v->module.empty() && v->slot == slot;
+}
 
-    // The condition already leaves a boolean on the stack
-    emitJump(info.code, "ifeq", endLabel);
+auto Compiler::countedLoop(const Statement& init, const Statement& loop) -> std::optional<CountedLoop>
+{
+    const auto* js = std::get_if<JJStatement>(&init.content);
+    const auto* w = std::get_if<While>(&loop.content);
+    if (js == nullptr || w == nullptr || !w->counted || w->counterSlot < 0 || !js->module.empty() || js->slot < 0) {
+        return std::nullopt;
+    }
+    const auto start = integralLiteral(*js->value);
+    if (!start) {
+        return std::nullopt;
+    }
 
-    auto bodyInfo = generateAssembly(*w.body);
-    info.code += bodyInfo.code;
+    // i < bound, i <= bound, i > bound, i >= bound or i != bound
+    const Expr* condition = w->condition.get();
+    while (const auto* g = std::get_if<Grouping>(&condition->content)) {
+        condition = g->expression.get();
+    }
+    const auto* test = std::get_if<Binary>(&condition->content);
+    if (test == nullptr || !isLocal(*test->left, js->slot)) {
+        return std::nullopt;
+    }
+
+    // The body ends with i = i + step, i = step + i or i = i - step
+    const auto* body = std::get_if<Block>(&w->body->content);
+    if (body == nullptr || body->statements.empty()) {
+        return std::nullopt;
+    }
+    const auto* last = std::get_if<ExprStatement>(&body->statements.back()->content);
+    const auto* assign = last != nullptr ? std::get_if<Assign>(&last->expression->content) : nullptr;
+    const auto* update = assign != nullptr && assign->module.empty() && assign->slot == js->slot
+        ? std::get_if<Binary>(&assign->value->content)
+        : nullptr;
+    std::optional<long long> step;
+    if (update != nullptr && update->opr.type == TokenType::PLUS) {
+        step = isLocal(*update->left, js->slot) ? integralLiteral(*update->right)
+            : isLocal(*update->right, js->slot) ? integralLiteral(*update->left)
+                                                 : std::nullopt;
+    } else if (update != nullptr && update->opr.type == TokenType::MINUS && isLocal(*update->left, js->slot)) {
+        step = integralLiteral(*update->right);
+        step = step ? std::optional<long long>(-*step) : std::nullopt;
+    }
+    if (!step || *step == 0) {
+        return std::nullopt;
+    }
 
-    emitJump(info.code, "goto", conditionLabel);
+    // Nothing else may write the counter
+    auto assigned = LoopInvariants::assignedVariables(Statement { ExprStatement { test->right } });
+    for (size_t i = 0; i + 1 < body->statements.size(); ++i) {
+        assigned.merge(LoopInvariants::assignedVariables(*body->statements[i]));
+    }
+    if (assigned.count(js->name.getLexeme()) != 0) {
+        return std::nullopt;
+    }
+
+    CountedLoop counted { js, w, test->opr.type, test->right.get(), integralLiteral(*test->right), *start, *step, false };
+
+    // The counter must move towards the bound, so it wraps no sooner than the boxed loop would run out of memory
+    switch (counted.comparison) {
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+        if (counted.step < 0) {
+            return std::nullopt;
+        }
+        break;
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+        if (counted.step > 0) {
+            return std::nullopt;
+        }
+        break;
+    case TokenType::BANG_EQUAL:
+        // Only a literal bound the counter lands on exactly
+        if (!counted.limit || (*counted.limit - counted.start) % counted.step != 0
+            || (*counted.limit - counted.start) / counted.step < 0) {
+            return std::nullopt;
+        }
+        break;
+    default:
+        return std::nullopt;
+    }
+
+    // An int counter also has to hold the value one step past the bound
+    const auto fitsInt = [](const long long value) { return value >= INT_MIN && value <= INT_MAX; };
+    counted.isLong = !counted.limit || !fitsInt(counted.start) || !fitsInt(counted.step) || !fitsInt(*counted.limit)
+        || !fitsInt(*counted.limit + counted.step);
+    return counted;
+}
+
+void Compiler::generateCounterTest(AssemblyInfo& info, const CountedLoop& counted, const std::string& label, const bool jumpIfTrue)
+{
+    std::string trueJump;
+    std::string falseJump;
+    switch (counted.comparison) {
+    case TokenType::LESS:
+        trueJump = "lt";
+        falseJump = "ge";
+        break;
+    case TokenType::LESS_EQUAL:
+        trueJump = "le";
+        falseJump = "gt";
+        break;
+    case TokenType::GREATER:
+        trueJump = "gt";
+        falseJump = "le";
+        break;
+    case TokenType::GREATER_EQUAL:
+        trueJump = "ge";
+        falseJump = "lt";
+        break;
+    default:
+        trueJump = "ne";
+        falseJump = "eq";
+        break;
+    }
+
+    const Counter& counter = counters.at(counted.counter->slot);
+    const std::string slot = std::to_string(counter.slot);
+    if (!counter.isLong) {
+        emitInstruction(info.code, "iload " + slot);
+        emitInstruction(info.code, "ldc " + std::to_string(*counted.limit));
+        emitJump(info.code, "if_icmp" + (jumpIfTrue ? trueJump : falseJump), label);
+        return;
+    }
+
+    if (counted.limit) {
+        emitInstruction(info.code, "lload " + slot);
+        emitInstruction(info.code, "ldc2_w " + std::to_string(*counted.limit) + "L");
+        emitInstruction(info.code, "lcmp");
+    } else {
+        // Any other bound is evaluated every iteration, as the boxed loop would, and compared exactly
+        info.code += generateAssembly(*counted.bound).code;
+        emitInstruction(info.code, "lload " + slot);
+        emitMethodCall(info.code, "Types/JayObject", "compareCounter", "(J)I", false);
+    }
+    emitJump(info.code, "if" + (jumpIfTrue ? trueJump : falseJump), label);
+}
+
+auto Compiler::generateCountedLoop(const CountedLoop& counted) -> AssemblyInfo
+{
+    const JJStatement& js = *counted.counter;
+    const While& w = *counted.loop;
+    const auto& iteration = std::get<Block>(w.body->content).statements;
+
+    AssemblyInfo info;
+    std::string startLabel = generateLabel();
+    std::string bodyLabel = generateLabel();
+    std::string conditionLabel = generateLabel();
+    std::string endLabel = generateLabel();
+
+    const int outerLine = currentLine;
+    currentLine = js.name.line;
+    markLine(info.code, currentLine);
+    if (profile) {
+        emitProfileCount(info.code, addProfileSite("statement", currentLine, "for " + js.name.getLexeme()));
+    }
+
+    const Counter counter { w.counterSlot, counted.isLong };
+    const std::string slot = std::to_string(counter.slot);
+    if (counter.isLong) {
+        emitInstruction(info.code, "ldc2_w " + std::to_string(counted.start) + "L");
+        emitInstruction(info.code, "lstore " + slot);
+    } else {
+        emitInstruction(info.code, "ldc " + std::to_string(counted.start));
+        emitInstruction(info.code, "istore " + slot);
+    }
+    emitLabel(info.code, startLabel);
+    counters[js.slot] = counter;
+
+    if (w.invariants.empty()) {
+        emitJump(info.code, "goto", conditionLabel);
+    } else {
+        generateCounterTest(info, counted, endLabel, false);
+        for (const auto& [expr, hoistedSlot] : w.invariants) {
+            auto exprInfo = generateAssembly(*expr);
+            info.code += exprInfo.code;
+            emitInstruction(info.code, "astore " + std::to_string(hoistedSlot));
+            hoisted[expr.get()] = { static_cast<size_t>(hoistedSlot), exprInfo.type };
+        }
+    }
+    emitLabel(info.code, bodyLabel);
+    if (profile) {
+        emitProfileCount(info.code, addProfileSite("loop", currentLine, "for iteration"));
+    }
+
+    // Everything but the trailing step, which updates the primitive directly
+    for (size_t i = 0; i + 1 < iteration.size(); ++i) {
+        info.code += generateAssembly(*iteration[i]).code;
+    }
+    if (counter.isLong) {
+        emitInstruction(info.code, "lload " + slot);
+        emitInstruction(info.code, "ldc2_w " + std::to_string(counted.step) + "L");
+        emitInstruction(info.code, "ladd");
+        emitInstruction(info.code, "lstore " + slot);
+    } else if (counted.step >= -128 && counted.step <= 127) {
+        emitInstruction(info.code, "iinc " + slot + " " + std::to_string(counted.step));
+    } else {
+        emitInstruction(info.code, "iload " + slot);
+        emitInstruction(info.code, "ldc " + std::to_string(counted.step));
+        emitInstruction(info.code, "iadd");
+        emitInstruction(info.code, "istore " + slot);
+    }
+
+    emitLabel(info.code, conditionLabel);
+    if (w.line >= 0) {
+        markLine(info.code, w.line);
+    }
+    generateCounterTest(info, counted, bodyLabel, true);
     emitLabel(info.code, endLabel);
 
+    counters.erase(js.slot);
+    for (const auto& hoistedExpr : w.invariants) {
+        hoisted.erase(hoistedExpr.expression.get());
+    }
+    localVariableTable += slot + " is " + js.name.getLexeme() + (counter.isLong ? " J" : " I") + " from " + startLabel + " to " + endLabel + "\n";
+    currentLine = outerLine;
     return info;
 }
 
 auto Compiler::generateIfElseStatement(const IfStatement& ifStmt) -> AssemblyInfo
 {
     AssemblyInfo info;
-    auto conditionInfo = generateAssembly(*ifStmt.condition);
-    info.code += conditionInfo.code;
-
     std::string elseLabel = generateLabel();
     std::string endLabel = generateLabel();
 
-    emitJump(info.code, "ifeq", elseLabel);
+    generateCondition(info, *ifStmt.condition, elseLabel, false);
 
     auto ifBlockInfo = generateAssembly(*ifStmt.ifBlock);
     info.code += ifBlockInfo.code;
-    emitJump(info.code, "goto", endLabel);
+    if (ifStmt.elseBlock != nullptr) {
+        emitJump(info.code, "goto", endLabel);
+    }
 
     emitLabel(info.code, elseLabel);
     if (ifStmt.elseBlock != nullptr) {
         auto elseBlockInfo = generateAssembly(*ifStmt.elseBlock);
         info.code += elseBlockInfo.code;
+        emitLabel(info.code, endLabel);
     }
 
-    emitLabel(info.code, endLabel);
-
     return info;
 }
 
 auto Compiler::generateAssembly(const Statement& stmt) -> AssemblyInfo
+{
+    if (std::holds_alternative<Block>(stmt.content) || std::holds_alternative<Function>(stmt.content)) {
+        return generateStatement(stmt);
+    }
+
+    auto [line, description] = std::visit(overloaded {
+                                              [](const PrintStatement& ps) { return std::make_pair(ps.line, std::string("print")); },
+                                              [](const ExprStatement& es) { return std::make_pair(es.line, std::string("expression")); },
+                                              [](const JJStatement& js) { return std::make_pair(js.name.line, "jj " + js.name.getLexeme()); },
+                                              [](const While& w) { return std::make_pair(w.line, std::string("while")); },
+                                              [](const IfStatement& i) { return std::make_pair(i.line, std::string("if")); },
+                                              [](const Import& i) { return std::make_pair(i.module.line, "import " + i.module.getLexeme()); },
+                                              [](auto&) { return std::make_pair(-1, std::string()); } },
+        stmt.content);
+    const int outerLine = currentLine;
+    currentLine = line < 0 ? currentLine : line;
+
+    AssemblyInfo info;
+    markLine(info.code, currentLine);
+    if (profile) {
+        emitProfileCount(info.code, addProfileSite("statement", currentLine, description));
+    }
+    auto statementInfo = generateStatement(stmt);
+    info.code += statementInfo.code;
+
+    currentLine = outerLine;
+    return info;
+}
+
+auto Compiler::generateStatement(const Statement& stmt) -> AssemblyInfo
 {
     return std::visit(overloaded {
                           [&](const PrintStatement& ps) {
                               AssemblyInfo info = {};
-                              emitInstruction(info.code, "getstatic java/lang/System/out Ljava/io/PrintStream;");
                               auto exprInfo = generateAssembly(*(ps.expression));
                               info.code += exprInfo.code;
                               emitMethodCall(info.code, "Types/JayObject", "toString", "()Ljava/lang/String;", false);
-                              emitMethodCall(info.code, "java/io/PrintStream", "println", "(Ljava/lang/String;)V", false);
+                              emitMethodCall(info.code, "Runtime/JayLog", "println", "(Ljava/lang/String;)V", true);
                               return info;
                           },
                           [&](const ExprStatement& es) {
@@ -244,14 +1123,20 @@ auto Compiler::generateAssembly(const Statement& stmt) -> AssemblyInfo
                           [&](const JJStatement& js) {
                               auto info = generateAssembly(*js.value);
 
-                              environment->define(js.name.getLexeme(), info);
-                              int index = environment->get(js.name.getLexeme())->index;
+                              if (!js.module.empty()) {
+                                  globalFields += ".field public static " + js.name.getLexeme() + " LTypes/JayObject;\n";
+                                  emitInstruction(info.code, "putstatic " + js.module + "/" + js.name.getLexeme() + " LTypes/JayObject;");
+                                  return info;
+                              }
+
+                              const int index = js.slot;
+                              setSlotType(index, info.type);
                               emitInstruction(info.code, "astore " + std::to_string(index));
 
-                              // Update the local variable table
+                              // In scope from the store to the end of the enclosing block
                               std::string startLabel = generateLabel();
-                              std::string endLabel = generateLabel();
-                              localVariableTable += std::to_string(index) + " is " + js.name.getLexeme() + " LTypes/JayObject; from " + startLabel + " to " + endLabel + "\n";
+                              emitLabel(info.code, startLabel);
+                              scopes.back().push_back({ index, js.name.getLexeme(), startLabel });
 
                               return info;
                           },
@@ -260,27 +1145,28 @@ auto Compiler::generateAssembly(const Statement& stmt) -> AssemblyInfo
                           },
                           [&](const Block& b) {
                               AssemblyInfo info = {};
-                              Environment* env = environment->createChild();
-                              environment = env;
 
                               std::string startLabel = generateLabel();
                               std::string endLabel = generateLabel();
 
                               emitLabel(info.code, startLabel);
 
-                              for (const std::shared_ptr<Statement>& ptr : b.statements) {
-                                  auto [code, maxStackDepth, currentDepth, type] = generateAssembly(*ptr);
+                              scopes.emplace_back();
+                              for (size_t i = 0; i < b.statements.size(); ++i) {
+                                  // A for loop's counter declaration and loop can compile together to a primitive counter
+                                  if (i + 1 < b.statements.size()) {
+                                      if (auto counted = countedLoop(*b.statements[i], *b.statements[i + 1])) {
+                                          info.code += generateCountedLoop(*counted).code;
+                                          ++i;
+                                          continue;
+                                      }
+                                  }
+                                  auto [code, maxStackDepth, currentDepth, type] = generateAssembly(*b.statements[i]);
                                   info.code += code;
                               }
 
-                              for (auto& [name, variable] : env->variables) {
-                                  localVariableTable += std::to_string(variable.index) + " is " + variable.name + "  Ljava/lang/String;" + " from " + startLabel + " to " + endLabel + "\n";
-                              }
-
                               emitLabel(info.code, endLabel);
-
-                              this->environment = this->environment->parent;
-                              delete this->environment->child;
+                              closeScope(endLabel);
                               return info;
                           },
                           [&](const IfStatement& i) {
@@ -289,6 +1175,12 @@ auto Compiler::generateAssembly(const Statement& stmt) -> AssemblyInfo
                           [&](const Function) -> AssemblyInfo {
                               return {};
                           },
+                          [&](const Import& i) {
+                              // Runs the module's top level once so its variables are initialised
+                              AssemblyInfo info = {};
+                              emitMethodCall(info.code, i.module.getLexeme(), "run", "()V", true);
+                              return info;
+                          },
                           [&](auto&) {
                               throw std::runtime_error("Unsupported statement type");
                           } },
@@ -297,33 +1189,45 @@ auto Compiler::generateAssembly(const Statement& stmt) -> AssemblyInfo
 
 auto Compiler::generateAssembly(const Expr& expr) -> AssemblyInfo
 {
+    if (auto it = hoisted.find(&expr); it != hoisted.end()) {
+        AssemblyInfo info;
+        emitInstruction(info.code, "aload " + std::to_string(it->second.index));
+        info.type = it->second.type;
+        return info;
+    }
+
     return std::visit(overloaded {
                           [&](const Literal& l) -> AssemblyInfo {
                               AssemblyInfo info;
                               std::visit(overloaded {
                                              [&](const double& d) {
-                                                 emitInstruction(info.code, "ldc2_w " + std::to_string(d));
-                                                 emitMethodCall(info.code, "Types/JayObject", "generateObject", "(D)LTypes/JayObject;",
+                                                 const std::string value = doubleText(d);
+                                                 std::string loadCode;
+                                                 emitInstruction(loadCode, "ldc2_w " + value);
+                                                 emitMethodCall(loadCode, "Types/JayObject", "generateObject", "(D)LTypes/JayObject;",
                                                      true);
+                                                 const std::string field = constantField("D" + value, loadCode);
+                                                 emitInstruction(info.code, "getstatic " + className + "/" + field + " LTypes/JayObject;");
                                                  info.updateDepth(1);
                                                  info.type = AssemblyInfo::Type::DECIMAL;
                                              },
                                              [&](const std::string& s) {
-                                                 emitInstruction(info.code, "ldc " + s);
-                                                 emitMethodCall(info.code, "Types/JayObject", "generateObject",
+                                                 std::string loadCode;
+                                                 emitInstruction(loadCode, "ldc " + s);
+                                                 emitMethodCall(loadCode, "Types/JayObject", "generateObject",
                                                      "(Ljava/lang/String;)LTypes/JayObject;", true);
+                                                 const std::string field = constantField("S" + s, loadCode);
+                                                 emitInstruction(info.code, "getstatic " + className + "/" + field + " LTypes/JayObject;");
                                                  info.updateDepth(1);
                                                  info.type = AssemblyInfo::Type::STRING;
                                              },
                                              [&](const bool& b) {
-                                                 emitInstruction(info.code, b ? "iconst_1" : "iconst_0");
-                                                 emitMethodCall(info.code, "Types/JayObject", "generateObject", "(Z)LTypes/JayObject;",
-                                                     true);
-                                                 info.updateDepth(2);
+                                                 emitInstruction(info.code, b ? "getstatic Types/JayBool/TRUE LTypes/JayBool;" : "getstatic Types/JayBool/FALSE LTypes/JayBool;");
+                                                 info.updateDepth(1);
                                                  info.type = AssemblyInfo::Type::BOOL;
                                              },
                                              [&](const nullptr_t) {
-                                                 emitInstruction(info.code, "aconst_null");
+                                                 emitInstruction(info.code, "getstatic Types/JayNil/INSTANCE LTypes/JayNil;");
                                                  info.updateDepth(1);
                                                  info.type = AssemblyInfo::Type::NULL_T;
                                              },
@@ -334,8 +1238,11 @@ auto Compiler::generateAssembly(const Expr& expr) -> AssemblyInfo
                           [&](const Grouping& g) {
                               return generateAssembly(*g.expression);
                           },
-                          [&](const Logical& l) -> AssemblyInfo {
-                              return generateBytecode(Binary { l.left, l.token, l.right });
+                          [&](const Logical& l) {
+                              return generateBytecode(l);
+                          },
+                          [&](const Ternary& t) {
+                              return generateBytecode(t);
                           },
                           [&](const Unary& u) {
                               return generateBytecode(u);
@@ -348,19 +1255,48 @@ auto Compiler::generateAssembly(const Expr& expr) -> AssemblyInfo
                               if (variable.name.getLexeme() == "JavaStaticCall") {
                                   return JavaStaticCall(c.args);
                               }
+                              if (variable.name.getLexeme() == "flush") {
+                                  if (!c.args.empty()) {
+                                      throw std::runtime_error("flush takes no arguments");
+                                  }
+                                  AssemblyInfo info;
+                                  emitMethodCall(info.code, "Runtime/JayLog", "flush", "()V", true);
+                                  emitInstruction(info.code, "getstatic Types/JayNil/INSTANCE LTypes/JayNil;");
+                                  info.type = AssemblyInfo::Type::NULL_T;
+                                  return info;
+                              }
                               return {};
                           },
                           [&](const Variable& v) -> AssemblyInfo {
                               AssemblyInfo info;
-                              const auto element = environment->get(v.name.getLexeme());
-                              emitInstruction(info.code, "aload " + std::to_string(element->index));
-                              info.type = element->info.type;
+                              if (!v.module.empty()) {
+                                  emitInstruction(info.code, "getstatic " + v.module + "/" + v.name.getLexeme() + " LTypes/JayObject;");
+                                  info.type = AssemblyInfo::Type::OBJECT;
+                                  return info;
+                              }
+                              if (v.slot < 0) {
+                                  throw std::runtime_error("Undefined variable " + v.name.getLexeme());
+                              }
+                              if (auto it = counters.find(v.slot); it != counters.end()) {
+                                  // Boxed only where the loop reads it as a value
+                                  const auto& [slot, isLong] = it->second;
+                                  emitInstruction(info.code, (isLong ? "lload " : "iload ") + std::to_string(slot));
+                                  emitMethodCall(info.code, "Types/JayObject", "generateObject", isLong ? "(J)LTypes/JayObject;" : "(I)LTypes/JayObject;", true);
+                                  info.type = AssemblyInfo::Type::DECIMAL;
+                                  return info;
+                              }
+                              emitInstruction(info.code, "aload " + std::to_string(v.slot));
+                              info.type = slotType(v.slot);
                               return info;
                           },
                           [&](const Assign& a) -> AssemblyInfo {
                               AssemblyInfo info = generateAssembly(*a.value);
-                              const int index = environment->assign(a.name.getLexeme(), info);
-                              emitInstruction(info.code, "astore " + std::to_string(index));
+                              if (!a.module.empty()) {
+                                  emitInstruction(info.code, "putstatic " + a.module + "/" + a.name.getLexeme() + " LTypes/JayObject;");
+                                  return info;
+                              }
+                              setSlotType(a.slot, info.type);
+                              emitInstruction(info.code, "astore " + std::to_string(a.slot));
                               return info;
                           },
 
@@ -381,3 +1317,27 @@ auto Compiler::isTruthy(const Expr& object) -> bool
     }
     return true;
 }
+
+auto Compiler::isBoolean(const Expr& expr) -> bool
+{
+    return std::visit(overloaded {
+                          [](const Literal& l) { return std::holds_alternative<bool>(l.literal); },
+                          [](const Grouping& g) { return isBoolean(*g.expression); },
+                          [](const Unary& u) { return u.opr.type == TokenType::BANG; },
+                          [](const Binary& b) {
+                              switch (b.opr.type) {
+                              case TokenType::GREATER:
+                              case TokenType::GREATER_EQUAL:
+                              case TokenType::LESS:
+                              case TokenType::LESS_EQUAL:
+                              case TokenType::EQUAL_EQUAL:
+                              case TokenType::BANG_EQUAL:
+                                  return true;
+                              default:
+                                  return false;
+                              }
+                          },
+                          [](const Logical& l) { return isBoolean(*l.left) && isBoolean(*l.right); },
+                          [](const auto&) { return false; } },
+        expr.content);
+}
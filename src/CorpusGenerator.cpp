@@ -0,0 +1,122 @@
+#include "CorpusGenerator.h"
+#include <random>
+
+static constexpr int variables = 64;
+
+auto CorpusGenerator::shapes() -> const std::vector<std::pair<std::string, Shape>>&
+{
+    static const std::vector<std::pair<std::string, Shape>> names {
+        { "straight", Shape::STRAIGHT },
+        { "nested", Shape::NESTED },
+        { "blocks", Shape::BLOCKS },
+        { "interop", Shape::INTEROP },
+    };
+    return names;
+}
+
+/* mt19937's sequence is fixed by the standard; the distributions are not, so plain modulo is used */
+static std::string variable(std::mt19937& rng)
+{
+    return "v" + std::to_string(rng() % variables);
+}
+
+static std::string operand(std::mt19937& rng)
+{
+    return rng() % 2 ? variable(rng) : std::to_string(rng() % 1000);
+}
+
+static std::string arithmetic(std::mt19937& rng)
+{
+    static const char* const operators[] = { " + ", " - ", " * " };
+    return operators[rng() % 3];
+}
+
+static std::string nested(std::mt19937& rng, int depth)
+{
+    if (depth == 0) {
+        return operand(rng);
+    }
+    // Alternate which side grows so both left- and right-leaning trees are parsed
+    if (depth % 2) {
+        return "(" + nested(rng, depth - 1) + arithmetic(rng) + operand(rng) + ")";
+    }
+    return "(" + operand(rng) + arithmetic(rng) + nested(rng, depth - 1) + ")";
+}
+
+static std::string block(std::mt19937& rng, int depth, int& counter)
+{
+    const std::string name = "b" + std::to_string(counter++);
+    std::string body = "jj " + name + " = " + operand(rng) + ";\n";
+    switch (rng() % 3) {
+    case 0:
+        body += "if (" + name + " > " + std::to_string(rng() % 500) + ") { " + name + " = " + name + " * 2; } else { log " + name + "; }\n";
+        break;
+    case 1:
+        body += "while (" + name + " > 0) { " + name + " = " + name + " - " + std::to_string(1 + rng() % 50) + "; }\n";
+        break;
+    default:
+        body += variable(rng) + " = " + name + arithmetic(rng) + operand(rng) + ";\n";
+        break;
+    }
+    if (depth > 0) {
+        body += block(rng, depth - 1, counter);
+    }
+    return "{\n" + body + "}\n";
+}
+
+static std::string interop(std::mt19937& rng)
+{
+    struct Target {
+        const char* cls;
+        const char* method;
+        int arity;
+    };
+    static const Target calls[] = {
+        { "java.lang.Math", "max", 2 },
+        { "java.lang.Math", "min", 2 },
+        { "java.lang.Math", "abs", 1 },
+        { "java.lang.Math", "sqrt", 1 },
+        { "java.lang.String", "valueOf", 1 },
+    };
+    const Target& call = calls[rng() % 5];
+    std::string expression = "JavaStaticCall(\"" + std::string(call.cls) + "\", \"" + call.method + "\", " + variable(rng);
+    if (call.arity == 2) {
+        expression += ", " + operand(rng);
+    }
+    expression += ")";
+    return rng() % 2 ? "log " + expression + ";\n" : variable(rng) + " = " + expression + ";\n";
+}
+
+auto CorpusGenerator::generate(Shape shape, size_t bytes, uint32_t seed) -> std::string
+{
+    std::mt19937 rng { seed };
+    std::string source;
+    source.reserve(bytes + 256);
+
+    // Every shape works over the same declared variables
+    for (int i = 0; i < variables && source.size() < bytes; ++i) {
+        source += "jj v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+
+    int counter = 0;
+    while (source.size() < bytes) {
+        switch (shape) {
+        case Shape::STRAIGHT:
+            source += variable(rng) + " = " + operand(rng) + arithmetic(rng) + operand(rng) + arithmetic(rng) + operand(rng) + ";\n";
+            if (rng() % 16 == 0) {
+                source += "log " + variable(rng) + ";\n";
+            }
+            break;
+        case Shape::NESTED:
+            source += variable(rng) + " = " + nested(rng, 48) + ";\n";
+            break;
+        case Shape::BLOCKS:
+            source += block(rng, static_cast<int>(rng() % 6), counter);
+            break;
+        case Shape::INTEROP:
+            source += interop(rng);
+            break;
+        }
+    }
+    return source;
+}
@@ -0,0 +1,219 @@
+#include "Daemon.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Descriptors passed with each request: stdin, stdout, stderr */
+static constexpr int passedDescriptors = 3;
+
+static sockaddr_un socketAddress(const std::filesystem::path& path)
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    const std::string name = path.string();
+    if (name.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + name);
+    }
+    std::strncpy(address.sun_path, name.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+static void closeOnExec(const int fd)
+{
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+static bool readExactly(const int fd, void* data, size_t size)
+{
+    auto* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::read(fd, bytes, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writeExactly(const int fd, const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::write(fd, bytes, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int connectTo(const std::filesystem::path& socketPath)
+{
+    const sockaddr_un address = socketAddress(socketPath);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+Daemon::Daemon(std::filesystem::path socketPath, size_t workers, const std::string& invokedAs)
+    : socketPath(std::move(socketPath))
+    , driver(invokedAs)
+    , workers(workers)
+{
+}
+
+auto Daemon::defaultSocket() -> std::filesystem::path
+{
+    return BuildCache::defaultDirectory() / "daemon.sock";
+}
+
+void Daemon::serve()
+{
+    // A client that goes away mid-build must not take the daemon with it
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (const int running = connectTo(socketPath); running >= 0) {
+        close(running);
+        throw std::runtime_error("A daemon is already listening on " + socketPath.string());
+    }
+    std::filesystem::create_directories(socketPath.parent_path());
+    std::filesystem::remove(socketPath);
+
+    const sockaddr_un address = socketAddress(socketPath);
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0) {
+        throw std::runtime_error("Failed to listen on " + socketPath.string() + ": " + std::strerror(errno));
+    }
+    closeOnExec(listener);
+    std::cerr << "jj daemon listening on " << socketPath.string() << " with " << workers.size() << " workers" << std::endl;
+
+    while (true) {
+        const int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to accept a connection: ") + std::strerror(errno));
+        }
+        closeOnExec(connection);
+        workers.submit([this, connection] { handle(connection); });
+    }
+}
+
+void Daemon::handle(const int connection)
+{
+    // Header: payload length, with the client's descriptors attached
+    uint32_t length = 0;
+    iovec header { &length, sizeof(length) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * passedDescriptors)] {};
+    msghdr message {};
+    message.msg_iov = &header;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    Stdio stdio { -1, -1, -1 };
+    const ssize_t received = recvmsg(connection, &message, 0);
+    const cmsghdr* descriptors = received == sizeof(length) ? CMSG_FIRSTHDR(&message) : nullptr;
+    if (descriptors && descriptors->cmsg_type == SCM_RIGHTS
+        && descriptors->cmsg_len == CMSG_LEN(sizeof(int) * passedDescriptors)) {
+        int fds[passedDescriptors];
+        std::memcpy(fds, CMSG_DATA(descriptors), sizeof(fds));
+        for (const int fd : fds) {
+            closeOnExec(fd);
+        }
+        stdio = { fds[0], fds[1], fds[2] };
+    }
+
+    // Payload: working directory, then the build arguments, each NUL-terminated
+    std::string payload(length, '\0');
+    int status = EXIT_FAILURE;
+    if (stdio.in >= 0 && readExactly(connection, payload.data(), payload.size())) {
+        std::vector<std::string> fields;
+        for (size_t start = 0, end; (end = payload.find('\0', start)) != std::string::npos; start = end + 1) {
+            fields.push_back(payload.substr(start, end - start));
+        }
+
+        Options options {};
+        if (!fields.empty() && Options::parse({ fields.begin() + 1, fields.end() }, options)) {
+            options.workingDirectory = fields.front();
+            status = driver.run(options, stdio);
+        } else {
+            const std::string usage = "Usage: jj --connect [-O0|-O1|-O2] [--no-cache] [--jvm|--interp] [--profile] [--time-report] [--trace file.json [--trace-statements]] [--mem-report] [--parallel-codegen] [script.jay...]\n";
+            writeExactly(stdio.err, usage.data(), usage.size());
+        }
+    }
+
+    const int32_t reply = status;
+    writeExactly(connection, &reply, sizeof(reply));
+    for (const int fd : { stdio.in, stdio.out, stdio.err }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    close(connection);
+}
+
+auto Daemon::request(const std::filesystem::path& socketPath, const std::vector<std::string>& args) -> int
+{
+    const int connection = connectTo(socketPath);
+    if (connection < 0) {
+        throw std::runtime_error("No jj daemon is listening on " + socketPath.string());
+    }
+
+    std::string payload = std::filesystem::current_path().string();
+    payload += '\0';
+    for (const auto& arg : args) {
+        payload += arg;
+        payload += '\0';
+    }
+
+    uint32_t length = payload.size();
+    iovec header { &length, sizeof(length) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * passedDescriptors)] {};
+    msghdr message {};
+    message.msg_iov = &header;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr* descriptors = CMSG_FIRSTHDR(&message);
+    descriptors->cmsg_level = SOL_SOCKET;
+    descriptors->cmsg_type = SCM_RIGHTS;
+    descriptors->cmsg_len = CMSG_LEN(sizeof(int) * passedDescriptors);
+    const int fds[passedDescriptors] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    std::memcpy(CMSG_DATA(descriptors), fds, sizeof(fds));
+
+    int32_t status = EXIT_FAILURE;
+    const bool sent = sendmsg(connection, &message, 0) == sizeof(length)
+        && writeExactly(connection, payload.data(), payload.size());
+    if (!sent || !readExactly(connection, &status, sizeof(status))) {
+        close(connection);
+        throw std::runtime_error("Lost the connection to the jj daemon");
+    }
+    close(connection);
+    return status;
+}
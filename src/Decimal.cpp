@@ -0,0 +1,497 @@
+#include "Decimal.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+using Magnitude = std::vector<uint32_t>;
+
+/* MathContext.DECIMAL128 */
+static constexpr int64_t divisionDigits = 34;
+
+static constexpr uint32_t powersOfTen[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+static void trim(Magnitude& m)
+{
+    while (!m.empty() && m.back() == 0) {
+        m.pop_back();
+    }
+}
+
+static auto compareMagnitudes(const Magnitude& a, const Magnitude& b) -> int
+{
+    if (a.size() != b.size()) {
+        return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static auto addMagnitudes(const Magnitude& a, const Magnitude& b) -> Magnitude
+{
+    const Magnitude& longer = a.size() >= b.size() ? a : b;
+    const Magnitude& shorter = a.size() >= b.size() ? b : a;
+    Magnitude sum(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        carry += static_cast<uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0);
+        sum[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    sum[longer.size()] = static_cast<uint32_t>(carry);
+    trim(sum);
+    return sum;
+}
+
+/* a - b, where a >= b */
+static auto subtractMagnitudes(const Magnitude& a, const Magnitude& b) -> Magnitude
+{
+    Magnitude difference(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int64_t digit = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = digit < 0 ? 1 : 0;
+        difference[i] = static_cast<uint32_t>(digit + (borrow << 32));
+    }
+    trim(difference);
+    return difference;
+}
+
+static auto multiplyMagnitudes(const Magnitude& a, const Magnitude& b) -> Magnitude
+{
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    Magnitude product(a.size() + b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); ++j) {
+            const uint64_t t = static_cast<uint64_t>(a[i]) * b[j] + product[i + j] + carry;
+            product[i + j] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        product[i + b.size()] = static_cast<uint32_t>(carry);
+    }
+    trim(product);
+    return product;
+}
+
+static void multiplySmall(Magnitude& m, const uint32_t factor)
+{
+    uint64_t carry = 0;
+    for (uint32_t& limb : m) {
+        const uint64_t t = static_cast<uint64_t>(limb) * factor + carry;
+        limb = static_cast<uint32_t>(t);
+        carry = t >> 32;
+    }
+    if (carry != 0) {
+        m.push_back(static_cast<uint32_t>(carry));
+    }
+    trim(m);
+}
+
+/* Divides in place and returns the remainder */
+static auto divideSmall(Magnitude& m, const uint32_t divisor) -> uint32_t
+{
+    uint64_t remainder = 0;
+    for (size_t i = m.size(); i-- > 0;) {
+        remainder = (remainder << 32) | m[i];
+        m[i] = static_cast<uint32_t>(remainder / divisor);
+        remainder %= divisor;
+    }
+    trim(m);
+    return static_cast<uint32_t>(remainder);
+}
+
+static void scaleByPowerOfTen(Magnitude& m, int64_t exponent)
+{
+    for (; exponent >= 9; exponent -= 9) {
+        multiplySmall(m, powersOfTen[9]);
+    }
+    if (exponent > 0) {
+        multiplySmall(m, powersOfTen[exponent]);
+    }
+}
+
+static auto powerOfTen(const int64_t exponent) -> Magnitude
+{
+    Magnitude m { 1 };
+    scaleByPowerOfTen(m, exponent);
+    return m;
+}
+
+static auto leadingZeros(uint32_t limb) -> int
+{
+    int count = 0;
+    while (count < 32 && (limb & 0x80000000u) == 0) {
+        limb <<= 1;
+        ++count;
+    }
+    return count;
+}
+
+static auto shiftLeft(const Magnitude& m, const int bits, const size_t size) -> Magnitude
+{
+    Magnitude shifted(size);
+    for (size_t i = 0; i < m.size(); ++i) {
+        shifted[i] |= bits == 0 ? m[i] : m[i] << bits;
+        if (bits != 0 && i + 1 < size) {
+            shifted[i + 1] |= m[i] >> (32 - bits);
+        }
+    }
+    return shifted;
+}
+
+/* Knuth's algorithm D; the divisor is not zero */
+static auto divideMagnitudes(const Magnitude& a, const Magnitude& b, Magnitude& remainder) -> Magnitude
+{
+    if (compareMagnitudes(a, b) < 0) {
+        remainder = a;
+        return {};
+    }
+    if (b.size() == 1) {
+        Magnitude quotient = a;
+        const uint32_t r = divideSmall(quotient, b[0]);
+        remainder = r == 0 ? Magnitude {} : Magnitude { r };
+        return quotient;
+    }
+
+    // Normalise so the divisor's top limb has its high bit set, which keeps each estimated digit at most two too big
+    const int bits = leadingZeros(b.back());
+    const Magnitude v = shiftLeft(b, bits, b.size());
+    Magnitude u = shiftLeft(a, bits, a.size() + 1);
+    const size_t n = v.size();
+    const size_t m = a.size() - n;
+    Magnitude quotient(m + 1);
+
+    for (size_t j = m + 1; j-- > 0;) {
+        const uint64_t top = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+        uint64_t estimate = top / v[n - 1];
+        uint64_t rest = top % v[n - 1];
+        while (estimate >> 32 != 0 || estimate * v[n - 2] > ((rest << 32) | u[j + n - 2])) {
+            --estimate;
+            rest += v[n - 1];
+            if (rest >> 32 != 0) {
+                break;
+            }
+        }
+
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t product = estimate * v[i] + carry;
+            carry = product >> 32;
+            const int64_t t = static_cast<int64_t>(u[i + j]) - borrow - static_cast<int64_t>(product & 0xffffffff);
+            u[i + j] = static_cast<uint32_t>(t);
+            borrow = t < 0 ? 1 : 0;
+        }
+        const int64_t t = static_cast<int64_t>(u[j + n]) - borrow - static_cast<int64_t>(carry);
+        u[j + n] = static_cast<uint32_t>(t);
+
+        if (t < 0) {
+            // The estimate was one too big: add the divisor back
+            --estimate;
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; ++i) {
+                sum += static_cast<uint64_t>(u[i + j]) + v[i];
+                u[i + j] = static_cast<uint32_t>(sum);
+                sum >>= 32;
+            }
+            u[j + n] += static_cast<uint32_t>(sum);
+        }
+        quotient[j] = static_cast<uint32_t>(estimate);
+    }
+
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        remainder[i] = bits == 0 ? u[i] : (u[i] >> bits) | (u[i + 1] << (32 - bits));
+    }
+    trim(remainder);
+    trim(quotient);
+    return quotient;
+}
+
+static auto toDigits(const Magnitude& m) -> std::string
+{
+    if (m.empty()) {
+        return "0";
+    }
+    std::vector<uint32_t> chunks;
+    Magnitude rest = m;
+    while (!rest.empty()) {
+        chunks.push_back(divideSmall(rest, powersOfTen[9]));
+    }
+    std::string digits = std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        const std::string chunk = std::to_string(chunks[i]);
+        digits.append(9 - chunk.size(), '0');
+        digits += chunk;
+    }
+    return digits;
+}
+
+static auto digitCount(const Magnitude& m) -> int64_t
+{
+    return static_cast<int64_t>(toDigits(m).size());
+}
+
+static auto isEven(const Magnitude& m) -> bool
+{
+    return m.empty() || (m[0] & 1) == 0;
+}
+
+Decimal::Decimal(std::vector<uint32_t> magnitude, const int64_t scale, const bool negative)
+    : magnitude(std::move(magnitude))
+    , scale(static_cast<int32_t>(scale))
+    , negative(negative && !this->magnitude.empty())
+{
+    // BigDecimal keeps its scale in an int as well
+    if (scale > INT32_MAX || scale < INT32_MIN) {
+        throw std::range_error(scale > 0 ? "Underflow" : "Overflow");
+    }
+}
+
+auto Decimal::fromDouble(const double d) -> Decimal
+{
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(d));
+    const bool sign = (bits >> 63) != 0;
+    const auto biased = static_cast<int64_t>((bits >> 52) & 0x7ff);
+    uint64_t significand = bits & ((uint64_t { 1 } << 52) - 1);
+    if (biased == 0x7ff) {
+        throw std::invalid_argument("Infinite or NaN");
+    }
+    if (significand == 0 && biased == 0) {
+        return {};
+    }
+    int64_t exponent = biased == 0 ? -1074 : biased - 1075;
+    if (biased != 0) {
+        significand |= uint64_t { 1 } << 52;
+    }
+    while ((significand & 1) == 0) {
+        significand >>= 1;
+        ++exponent;
+    }
+
+    Magnitude m { static_cast<uint32_t>(significand), static_cast<uint32_t>(significand >> 32) };
+    trim(m);
+    if (exponent >= 0) {
+        for (; exponent >= 31; exponent -= 31) {
+            multiplySmall(m, uint32_t { 1 } << 31);
+        }
+        multiplySmall(m, uint32_t { 1 } << exponent);
+        return { std::move(m), 0, sign };
+    }
+    // d = significand / 2^k = significand * 5^k / 10^k
+    int64_t k = -exponent;
+    for (; k >= 13; k -= 13) {
+        multiplySmall(m, 1220703125);
+    }
+    for (; k > 0; --k) {
+        multiplySmall(m, 5);
+    }
+    return { std::move(m), -exponent, sign };
+}
+
+auto Decimal::parse(const std::string_view text) -> Decimal
+{
+    size_t i = 0;
+    bool sign = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        sign = text[i++] == '-';
+    }
+    Magnitude m;
+    int64_t fraction = 0;
+    bool point = false;
+    for (; i < text.size() && text[i] != 'E' && text[i] != 'e'; ++i) {
+        if (text[i] == '.') {
+            point = true;
+            continue;
+        }
+        multiplySmall(m, 10);
+        if (text[i] != '0') {
+            m = addMagnitudes(m, Magnitude { static_cast<uint32_t>(text[i] - '0') });
+        }
+        if (point) {
+            ++fraction;
+        }
+    }
+    const int64_t exponent = i < text.size() ? std::strtoll(std::string(text.substr(i + 1)).c_str(), nullptr, 10) : 0;
+    return { std::move(m), fraction - exponent, sign };
+}
+
+auto Decimal::add(const Decimal& other) const -> Decimal
+{
+    Magnitude a = magnitude;
+    Magnitude b = other.magnitude;
+    const int64_t resultScale = std::max(scale, other.scale);
+    scaleByPowerOfTen(a, resultScale - scale);
+    scaleByPowerOfTen(b, resultScale - other.scale);
+    if (negative == other.negative) {
+        return { addMagnitudes(a, b), resultScale, negative };
+    }
+    if (compareMagnitudes(a, b) >= 0) {
+        return { subtractMagnitudes(a, b), resultScale, negative };
+    }
+    return { subtractMagnitudes(b, a), resultScale, other.negative };
+}
+
+auto Decimal::subtract(const Decimal& other) const -> Decimal
+{
+    return add(other.negate());
+}
+
+auto Decimal::multiply(const Decimal& other) const -> Decimal
+{
+    return { multiplyMagnitudes(magnitude, other.magnitude), static_cast<int64_t>(scale) + other.scale,
+        negative != other.negative };
+}
+
+auto Decimal::divide(const Decimal& other) const -> Decimal
+{
+    const int64_t preferredScale = static_cast<int64_t>(scale) - other.scale;
+    if (isZero()) {
+        return { {}, preferredScale, false };
+    }
+
+    // Shift the dividend so the integer quotient has one or two digits more than the precision
+    const int64_t shift = divisionDigits + digitCount(other.magnitude) - digitCount(magnitude) + 1;
+    Magnitude dividend = magnitude;
+    Magnitude divisor = other.magnitude;
+    scaleByPowerOfTen(shift > 0 ? dividend : divisor, shift > 0 ? shift : -shift);
+    Magnitude remainder;
+    Magnitude quotient = divideMagnitudes(dividend, divisor, remainder);
+    int64_t resultScale = preferredScale + shift;
+    bool exact = remainder.empty();
+
+    const int64_t excess = digitCount(quotient) - divisionDigits;
+    if (excess > 0) {
+        const Magnitude unit = powerOfTen(excess);
+        Magnitude dropped;
+        quotient = divideMagnitudes(quotient, unit, dropped);
+        resultScale -= excess;
+        // Half-even, with any remainder of the first division breaking a tie upwards
+        const int half = compareMagnitudes(addMagnitudes(dropped, dropped), unit);
+        if (half > 0 || (half == 0 && (!exact || !isEven(quotient)))) {
+            quotient = addMagnitudes(quotient, Magnitude { 1 });
+            if (digitCount(quotient) > divisionDigits) {
+                divideSmall(quotient, 10);
+                --resultScale;
+            }
+        }
+        exact = exact && dropped.empty();
+    }
+
+    if (exact) {
+        // The exact quotient takes the scale closest to the preferred one
+        while (resultScale > preferredScale) {
+            Magnitude shorter = quotient;
+            if (divideSmall(shorter, 10) != 0) {
+                break;
+            }
+            quotient = std::move(shorter);
+            --resultScale;
+        }
+    }
+    return { std::move(quotient), resultScale, negative != other.negative };
+}
+
+auto Decimal::negate() const -> Decimal
+{
+    return { magnitude, scale, !negative };
+}
+
+auto Decimal::compare(const Decimal& other) const -> int
+{
+    const int sign = isZero() ? 0 : negative ? -1 : 1;
+    const int otherSign = other.isZero() ? 0 : other.negative ? -1 : 1;
+    if (sign != otherSign || sign == 0) {
+        return sign < otherSign ? -1 : sign > otherSign ? 1 : 0;
+    }
+    Magnitude a = magnitude;
+    Magnitude b = other.magnitude;
+    const int64_t commonScale = std::max(scale, other.scale);
+    scaleByPowerOfTen(a, commonScale - scale);
+    scaleByPowerOfTen(b, commonScale - other.scale);
+    return sign * compareMagnitudes(a, b);
+}
+
+bool Decimal::operator==(const Decimal& other) const
+{
+    return negative == other.negative && scale == other.scale && magnitude == other.magnitude;
+}
+
+auto Decimal::toInteger() const -> std::optional<double>
+{
+    if (scale != 0 || magnitude.size() > 2) {
+        return std::nullopt;
+    }
+    const uint64_t value = magnitude.empty() ? 0 : magnitude[0] | (magnitude.size() > 1 ? static_cast<uint64_t>(magnitude[1]) << 32 : 0);
+    if (value >= uint64_t { 1 } << 53) {
+        return std::nullopt;
+    }
+    const auto d = static_cast<double>(value);
+    return negative ? -d : d;
+}
+
+auto Decimal::toDouble() const -> double
+{
+    std::string text;
+    appendTo(text);
+    // strtod rounds to nearest, as BigDecimal.doubleValue does
+    return std::strtod(text.c_str(), nullptr);
+}
+
+auto Decimal::intValue() const -> int32_t
+{
+    Magnitude integer = magnitude;
+    if (scale > 0) {
+        Magnitude fraction;
+        integer = divideMagnitudes(integer, powerOfTen(scale), fraction);
+    } else if (scale < 0) {
+        // Only the low 32 bits matter, and 10^32 already clears them
+        scaleByPowerOfTen(integer, std::min<int64_t>(-static_cast<int64_t>(scale), 32));
+    }
+    const uint32_t low = integer.empty() ? 0 : integer[0];
+    return static_cast<int32_t>(negative ? 0u - low : low);
+}
+
+void Decimal::appendTo(std::string& text) const
+{
+    const std::string digits = toDigits(magnitude);
+    const int64_t length = static_cast<int64_t>(digits.size());
+    const int64_t adjusted = -static_cast<int64_t>(scale) + length - 1;
+    if (negative) {
+        text += '-';
+    }
+    if (scale >= 0 && adjusted >= -6) {
+        if (scale == 0) {
+            text += digits;
+        } else if (length > scale) {
+            text.append(digits, 0, length - scale);
+            text += '.';
+            text.append(digits, length - scale);
+        } else {
+            text += "0.";
+            text.append(scale - length, '0');
+            text += digits;
+        }
+        return;
+    }
+    text += digits[0];
+    if (length > 1) {
+        text += '.';
+        text.append(digits, 1);
+    }
+    if (adjusted != 0) {
+        text += 'E';
+        if (adjusted > 0) {
+            text += '+';
+        }
+        text += std::to_string(adjusted);
+    }
+}
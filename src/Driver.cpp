@@ -0,0 +1,655 @@
+#include "Driver.h"
+#include "BytecodeCompiler.h"
+#include "Compiler.h"
+#include "Interpreter.h"
+#include "Linker.h"
+#include "MemoryTracker.h"
+#include "NativeImageConfig.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "Scanner.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+static std::string fromEnvironment(const char* name, const std::string& fallback)
+{
+    const char* value = std::getenv(name);
+    return value && *value ? value : fallback;
+}
+
+/* Tool locations; relative paths are resolved against the build's working directory */
+const std::string GRAALVMHOME = fromEnvironment("GRAALVM_HOME", "/Users/jamie/Library/Java/JavaVirtualMachines/graalvm-jdk-22.0.1+8.1/Contents/Home");
+const std::string NATIVEIMAGEPATH = GRAALVMHOME + "/bin/native-image";
+const std::string JAVAPATH = GRAALVMHOME + "/bin/java";
+const std::string JARPATH = GRAALVMHOME + "/bin/jar";
+const std::string KRAKATAUPATH = fromEnvironment("JAY_KRAK2", "../libs/Krakatau/target/release/krak2");
+const std::string JAYLIBPATH = fromEnvironment("JAY_LIB", "../jaylib/target/JayLib-0.1.jar");
+/* Bump whenever generated code changes, so older cache entries are not reused */
+const std::string COMPILERVERSION = "jj 0.2";
+
+/* One .jay file; compiled to a class of the same name */
+struct Module {
+    std::string name;
+    std::filesystem::path source;
+    std::string contents;
+    std::vector<std::shared_ptr<Statement>> program {};
+    std::vector<std::string> imports {};
+    std::unordered_set<std::string> globals {};
+    bool isLibrary = false;
+};
+
+/* Everything a build needs to know about where it reads and writes */
+struct Paths {
+    std::filesystem::path directory;
+    std::string baseName;
+    std::string outputDir;
+    std::string executable;
+    std::string configDir;
+    std::string runtimeJar;
+    std::string assembler;
+};
+
+auto Options::parse(const std::vector<std::string>& args, Options& options) -> bool
+{
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            options.optimizationLevel = arg[2] - '0';
+        } else if (arg == "--no-cache") {
+            options.useCache = false;
+        } else if (arg == "--jvm") {
+            options.jvm = true;
+        } else if (arg == "--time-report") {
+            options.timeReport = true;
+        } else if (arg == "--trace" && i + 1 < args.size()) {
+            options.tracePath = args[++i];
+        } else if (arg == "--trace-statements") {
+            options.traceStatements = true;
+        } else if (arg == "--interp") {
+            options.interp = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg == "--mem-report") {
+            options.memReport = true;
+        } else if (arg == "--parallel-codegen") {
+            options.parallelCodegen = true;
+        } else if (arg.rfind('-', 0) == 0) {
+            return false;
+        } else {
+            options.scripts.push_back(arg);
+        }
+    }
+    return !options.scripts.empty();
+}
+
+static void print(const int fd, const std::string& message)
+{
+    size_t written = 0;
+    while (written < message.size()) {
+        const ssize_t n = ::write(fd, message.data() + written, message.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        written += n;
+    }
+}
+
+static Module parseModule(const std::string& name, const std::filesystem::path& source, Trace& trace)
+{
+    std::ifstream ifs { source };
+    if (!ifs) {
+        throw std::runtime_error("Failed to open input file: " + source.string());
+    }
+
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    Scanner scanner { data };
+    std::vector<Token> output;
+    {
+        Trace::Span span { trace, "scan", name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::TOKENS };
+        output = scanner.scanTokens();
+    }
+
+    Parser parser { std::move(output) };
+    Module module { name, source, std::move(data) };
+    {
+        Trace::Span span { trace, "parse", name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::AST };
+        module.program = parser.parse();
+    }
+    const bool incomplete = std::any_of(module.program.begin(), module.program.end(),
+        [](const std::shared_ptr<Statement>& stmt) { return stmt == nullptr; });
+    if (scanner.err.error || parser.err.error || incomplete) {
+        throw std::runtime_error("Failed to parse " + source.string());
+    }
+
+    for (const auto& stmt : module.program) {
+        if (const auto* i = std::get_if<Import>(&stmt->content)) {
+            module.imports.push_back(i->module.getLexeme());
+        } else if (const auto* js = std::get_if<JJStatement>(&stmt->content)) {
+            module.globals.insert(js->name.getLexeme());
+        }
+    }
+    return module;
+}
+
+/* Everything a module's class depends on: its own source, its role, and the names its imports export */
+static std::string classKey(const Module& module, const std::unordered_map<std::string, Module>& modules,
+    const BuildCache::Key& base)
+{
+    BuildCache::Key key = base;
+    key.add("class").add(module.name).add(module.isLibrary ? "library" : "entry").add(module.contents);
+    for (const auto& dependency : module.imports) {
+        std::vector<std::string> names(modules.at(dependency).globals.begin(), modules.at(dependency).globals.end());
+        std::sort(names.begin(), names.end());
+        key.add(dependency);
+        for (const auto& name : names) {
+            key.add(name);
+        }
+    }
+    return key.str();
+}
+
+/* Parses the entry script and everything it imports, discovering modules as they are parsed.
+ * Every imported module is marked as a library. */
+static std::unordered_map<std::string, Module> loadModules(const std::filesystem::path& directory, const std::string& entry,
+    Trace& trace)
+{
+    ThreadPool pool {};
+    std::mutex modulesMutex;
+    std::unordered_map<std::string, Module> modules;
+    std::unordered_set<std::string> requested { entry };
+
+    std::function<void(const std::string&)> load = [&](const std::string& name) {
+        pool.submit([&, name] {
+            Module module = parseModule(name, directory / (name + ".jay"), trace);
+            std::lock_guard<std::mutex> lock(modulesMutex);
+            for (const auto& dependency : module.imports) {
+                if (requested.insert(dependency).second) {
+                    load(dependency);
+                }
+            }
+            modules.emplace(name, std::move(module));
+        });
+    };
+    load(entry);
+    pool.wait();
+
+    for (auto& [name, module] : modules) {
+        for (const auto& dependency : module.imports) {
+            modules.at(dependency).isLibrary = true;
+        }
+    }
+    return modules;
+}
+
+/* Link: every imported module exports its top-level variables */
+static Resolver::Exports exportsOf(const std::unordered_map<std::string, Module>& modules)
+{
+    Resolver::Exports exports;
+    for (const auto& [name, module] : modules) {
+        if (module.isLibrary) {
+            exports[name] = module.globals;
+        }
+    }
+    return exports;
+}
+
+/* Optimizes the module and binds its variables; returns how many local slots its code needs */
+static size_t analyseModule(Module& module, const Options& options, const Resolver::Exports& exports, Trace& trace)
+{
+    {
+        Trace::Span span { trace, "optimize", module.name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::OPTIMIZER };
+        Optimizer optimizer { options.optimizationLevel, module.isLibrary };
+        optimizer.optimize(module.program);
+    }
+    Resolver resolver { module.name, module.isLibrary, exports };
+    {
+        Trace::Span span { trace, "resolve", module.name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::SYMBOLS };
+        resolver.resolve(module.program);
+    }
+    return resolver.maxLocals;
+}
+
+/* Compiles the top-level statements a window at a time: every statement of the window on its own relocatable
+ * Compiler on the pool, then absorbed in source order. A statement that saw other variable types than serial
+ * codegen would have, or failed, is compiled again in place, so the code is exactly what the serial loop writes. */
+static void generateInParallel(Module& module, Compiler& compiler, Linker& linker, const Options& options, Trace& trace)
+{
+    ThreadPool pool {};
+    const size_t window = 64 * pool.size();
+    auto& program = module.program;
+    for (size_t first = 0; first < program.size(); first += window) {
+        const size_t count = std::min(window, program.size() - first);
+        std::vector<std::unique_ptr<Compiler>> fragments(count);
+        std::vector<std::string> code(count);
+        std::vector<char> failed(count, false);
+
+        auto types = compiler.variableTypes();
+        for (size_t i = 0; i < count; ++i) {
+            fragments[i] = std::make_unique<Compiler>(module.name, options.profile, true);
+            fragments[i]->assumeVariableTypes(types);
+            Compiler::predictVariableTypes(*program[first + i], types);
+            pool.submit([&, i] {
+                MemoryTracker::Scope memory { MemoryTracker::Category::CODE };
+                const auto start = trace.statements() ? Trace::Clock::now() : Trace::Clock::time_point {};
+                try {
+                    code[i] = fragments[i]->generateAssembly(*program[first + i]).code;
+                } catch (...) {
+                    // Compiled again below, in order, so the error reported is the one serial codegen hits first
+                    failed[i] = true;
+                }
+                if (trace.statements()) {
+                    trace.record("statement", module.name + " #" + std::to_string(first + i), start, Trace::Clock::now());
+                }
+            });
+        }
+        pool.wait();
+
+        for (size_t i = 0; i < count; ++i) {
+            if (!failed[i] && compiler.agreesWith(*fragments[i])) {
+                linker.addCode(compiler.absorb(*fragments[i], code[i]));
+            } else {
+                linker.addCode(compiler.generateAssembly(*program[first + i]).code);
+            }
+            fragments[i].reset();
+            code[i].clear();
+            program[first + i].reset();
+        }
+    }
+}
+
+/* Generates the module's assembly; the returned job assembles it into a class */
+static JobScheduler::Job compileModule(Module& module, const Paths& paths, const Options& options,
+    const Resolver::Exports& exports, const Stdio& stdio, Trace& trace)
+{
+    const size_t locals = analyseModule(module, options, exports, trace);
+
+    std::string asmFileName = paths.outputDir + "/src/" + module.name + ".j";
+
+    Compiler compiler { module.name, options.profile };
+    AssemblyInfo assem = {};
+    Linker linker { module.name, asmFileName, locals };
+    {
+        Trace::Span span { trace, "codegen", module.name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::CODE };
+        // With one core the relocation pass is pure overhead
+        if (options.parallelCodegen && std::thread::hardware_concurrency() > 1) {
+            generateInParallel(module, compiler, linker, options, trace);
+        } else {
+            for (size_t i = 0; i < module.program.size(); ++i) {
+                const auto start = trace.statements() ? Trace::Clock::now() : Trace::Clock::time_point {};
+                linker.addCode(compiler.generateAssembly(*module.program[i]).code);
+                // Each top-level statement is written out as soon as it is compiled
+                module.program[i].reset();
+                if (trace.statements()) {
+                    trace.record("statement", module.name + " #" + std::to_string(i), start, Trace::Clock::now());
+                }
+            }
+        }
+    }
+
+    {
+        Trace::Span span { trace, "link", module.name };
+        MemoryTracker::Scope memory { MemoryTracker::Category::LINK };
+        compiler.generateLocalVariables(assem);
+        linker.addCode(assem.code);
+        compiler.generateProfileTable(module.name + ".jay");
+        linker.addConstants(compiler.constantFields + compiler.globalFields, compiler.constantInitializer);
+        linker.close();
+    }
+    NativeImageConfig::saveTargets(compiler.javaTargets, paths.outputDir + "/src/" + module.name + ".reflect");
+
+    return { "krak2 " + module.name, "krak2", { paths.assembler, "asm", "--out", paths.outputDir + "/src", asmFileName },
+        options.workingDirectory, stdio.in, stdio.out, stdio.err };
+}
+
+/* A tool job's run as a span on its own timeline row */
+static void traceJob(Trace& trace, const std::string& phase, const std::string& detail, const JobScheduler::Result& result)
+{
+    if (!result.skipped) {
+        trace.record(phase, detail, result.start, result.end, phase + " " + detail);
+    }
+}
+
+/* Throws with the tool's output if the job did not succeed */
+static void check(const JobScheduler::Result& result, const std::string& message)
+{
+    if (!result.succeeded()) {
+        throw std::runtime_error(result.output + message);
+    }
+}
+
+/* Packs the classes into a jar for --jvm runs, which CDS needs: it only archives classes loaded from jars.
+ * The JVM creates the archive on the first run and reuses it until the classpath changes.
+ * Returns null when the jar is already newer than every class and none is being assembled. */
+static JobScheduler::Handle packageJar(const Paths& paths, const std::unordered_map<std::string, Module>& modules,
+    const std::vector<JobScheduler::Handle>& classes, const Options& options, const Stdio& stdio, JobScheduler& scheduler)
+{
+    const std::filesystem::path jarFile = paths.outputDir + "/bin/" + paths.baseName + ".jar";
+
+    bool stale = !classes.empty() || !std::filesystem::exists(jarFile);
+    std::vector<std::string> argv { JARPATH, "--create", "--file", jarFile.string(), "-C", paths.outputDir + "/src" };
+    for (const auto& [name, module] : modules) {
+        const std::filesystem::path classFile = paths.outputDir + "/src/" + name + ".class";
+        stale = stale || std::filesystem::last_write_time(classFile) > std::filesystem::last_write_time(jarFile);
+        argv.push_back(name + ".class");
+    }
+    if (!stale) {
+        return nullptr;
+    }
+    return scheduler.submit({ "jar " + paths.baseName, "jar", argv, options.workingDirectory, stdio.in, stdio.out, stdio.err },
+        classes);
+}
+
+/* The running jj binary: /proc/self/exe where there is one, otherwise argv[0] found the way the shell found it; empty
+ * when it cannot be located */
+static auto locateCompiler(const std::string& invokedAs) -> std::filesystem::path
+{
+    std::error_code ec;
+    if (std::filesystem::exists("/proc/self/exe", ec)) {
+        return "/proc/self/exe";
+    }
+    if (invokedAs.find('/') != std::string::npos) {
+        return std::filesystem::absolute(invokedAs, ec);
+    }
+    const std::string path = fromEnvironment("PATH", "");
+    for (size_t start = 0; start <= path.size();) {
+        size_t end = path.find(':', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        // An empty PATH entry stands for the working directory
+        const std::filesystem::path candidate = std::filesystem::absolute(
+            std::filesystem::path(end == start ? "." : path.substr(start, end - start)) / invokedAs, ec);
+        if (std::filesystem::is_regular_file(candidate, ec)) {
+            return candidate;
+        }
+        start = end + 1;
+    }
+    return {};
+}
+
+Driver::Driver(const std::string& invokedAs)
+    : scheduler({ { "krak2", std::max(1u, std::thread::hardware_concurrency()) },
+          { "native-image", JobScheduler::nativeImageSlots() } })
+    , compilerPath(locateCompiler(invokedAs))
+{
+}
+
+auto Driver::buildCache() -> BuildCache&
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cache) {
+        cache = std::make_unique<BuildCache>(BuildCache::defaultDirectory());
+    }
+    return *cache;
+}
+
+auto Driver::toolchainKey(const std::filesystem::path& runtimeJar) -> std::optional<BuildCache::Key>
+{
+    std::error_code ec;
+    const auto modified = std::filesystem::last_write_time(runtimeJar, ec);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Hashed on first use, so --interp runs never read the compiler binary
+    if (!compilerHashed) {
+        compilerHashed = true;
+        if (std::ifstream binary { compilerPath, std::ios::binary }; binary && !compilerPath.empty()) {
+            compilerKey = BuildCache::Key {};
+            compilerKey->add(COMPILERVERSION).addFile(compilerPath);
+        }
+    }
+    if (!compilerKey) {
+        return std::nullopt;
+    }
+    auto it = runtimeKeys.find(runtimeJar.string());
+    if (it == runtimeKeys.end() || it->second.first != modified) {
+        BuildCache::Key key = *compilerKey;
+        key.addFile(runtimeJar);
+        it = runtimeKeys.insert_or_assign(runtimeJar.string(), std::make_pair(modified, key)).first;
+    }
+    return it->second.second;
+}
+
+auto Driver::run(const Options& options, const Stdio& stdio) -> int
+{
+    Trace trace { options.timeReport || !options.tracePath.empty(), options.traceStatements };
+    int status = EXIT_SUCCESS;
+    if (options.interp) {
+        // Nothing to build: each script runs in-process once it is lowered
+        for (const auto& script : options.scripts) {
+            try {
+                interpret(script, options, stdio, trace);
+            } catch (const std::exception& e) {
+                print(stdio.err, std::string(e.what()) + "\n");
+                status = EXIT_FAILURE;
+            }
+        }
+    } else {
+        // Build every script at once; their tool jobs interleave in the shared scheduler
+        std::vector<Program> programs(options.scripts.size());
+        std::vector<std::string> errors(options.scripts.size());
+        std::vector<std::thread> builds;
+        for (size_t i = 0; i < options.scripts.size(); ++i) {
+            builds.emplace_back([&, i] {
+                try {
+                    programs[i] = build(options.scripts[i], options, stdio, trace);
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+            });
+        }
+        for (auto& thread : builds) {
+            thread.join();
+        }
+
+        for (size_t i = 0; i < programs.size(); ++i) {
+            if (!errors[i].empty()) {
+                print(stdio.err, errors[i] + "\n");
+                status = EXIT_FAILURE;
+                continue;
+            }
+            const auto run = scheduler.submit({ programs[i].mode + " run", "run", programs[i].argv, options.workingDirectory,
+                stdio.in, stdio.out, stdio.err, false });
+            traceJob(trace, "run", options.scripts[i], scheduler.wait(run));
+        }
+    }
+
+    if (options.timeReport) {
+        print(stdio.err, trace.report());
+    }
+    if (options.memReport) {
+        print(stdio.err, MemoryTracker::enabled() ? MemoryTracker::report() : "jj was built without JAY_MEMORY_TRACKING; --mem-report has nothing to show\n");
+    }
+    if (!options.tracePath.empty()) {
+        try {
+            trace.writeChromeTrace(options.workingDirectory / options.tracePath);
+        } catch (const std::exception& e) {
+            print(stdio.err, std::string(e.what()) + "\n");
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
+
+void Driver::interpret(const std::string& script, const Options& options, const Stdio& stdio, Trace& trace)
+{
+    const std::filesystem::path source = options.workingDirectory / script;
+    if (!source.has_extension() || source.extension() != ".jay") {
+        throw std::runtime_error("Error: Only .jay files are supported.");
+    }
+    const std::string entry = source.stem().string();
+
+    std::unordered_map<std::string, Module> modules = loadModules(source.parent_path(), entry, trace);
+    const Resolver::Exports exports = exportsOf(modules);
+
+    BytecodeProgram program;
+    BytecodeCompiler lowering { program };
+    for (auto& [name, module] : modules) {
+        const size_t locals = analyseModule(module, options, exports, trace);
+        Trace::Span span { trace, "lower", name };
+        lowering.compile(name, module.program, locals);
+    }
+
+    Interpreter interpreter { program, stdio.out };
+    Trace::Span span { trace, "run", entry };
+    interpreter.run(program.moduleIndex.at(entry));
+}
+
+auto Driver::build(const std::string& script, const Options& options, const Stdio& stdio, Trace& trace) -> Program
+{
+    const std::filesystem::path source = options.workingDirectory / script;
+    if (!source.has_extension() || source.extension() != ".jay") {
+        throw std::runtime_error("Error: Only .jay files are supported.");
+    }
+
+    Paths paths;
+    paths.directory = source.parent_path();
+    paths.baseName = source.stem().string();
+    paths.outputDir = (options.workingDirectory / paths.baseName).string();
+    paths.executable = paths.outputDir + "/bin/" + paths.baseName;
+    paths.configDir = paths.outputDir + "/META-INF/native-image";
+    paths.runtimeJar = (options.workingDirectory / JAYLIBPATH).lexically_normal().string();
+    paths.assembler = (options.workingDirectory / KRAKATAUPATH).lexically_normal().string();
+
+    std::filesystem::create_directories(paths.outputDir + "/src");
+    std::filesystem::create_directories(paths.outputDir + "/bin");
+
+    // Without the compiler binary's contents in the key a rebuilt jj could reuse stale output, so the cache is
+    // bypassed when the binary cannot be read
+    const std::optional<BuildCache::Key> toolchain = options.useCache ? toolchainKey(paths.runtimeJar) : std::nullopt;
+    BuildCache* cache = toolchain ? &buildCache() : nullptr;
+    BuildCache::Key base;
+    if (cache) {
+        base = *toolchain;
+        base.add("O" + std::to_string(options.optimizationLevel));
+        if (options.profile) {
+            base.add("profile");
+        }
+    }
+    std::string binaryKey;
+
+    std::unordered_map<std::string, Module> modules = loadModules(paths.directory, paths.baseName, trace);
+    const Resolver::Exports exports = exportsOf(modules);
+
+    std::vector<std::string> names;
+    for (const auto& [name, module] : modules) {
+        names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+
+    std::unordered_map<std::string, std::string> classKeys;
+    if (cache) {
+        Trace::Span span { trace, "cache", paths.baseName };
+        BuildCache::Key key = base;
+        key.add("binary").add(NATIVEIMAGEPATH).add(paths.baseName);
+        for (const auto& name : names) {
+            classKeys[name] = classKey(modules.at(name), modules, base);
+            key.add(name).add(classKeys[name]);
+        }
+        binaryKey = key.str();
+
+        // Nothing has changed since this program was last built: run the cached binary
+        if (!options.jvm && cache->fetch(binaryKey, paths.executable)) {
+            return { "native", { paths.executable } };
+        }
+    }
+
+    // Each module's assembler job is queued as soon as its code is generated
+    ThreadPool pool {};
+    std::mutex jobsMutex;
+    std::vector<std::pair<std::string, JobScheduler::Handle>> assembled;
+    for (auto& [name, module] : modules) {
+        const std::string classFile = paths.outputDir + "/src/" + name + ".class";
+        const std::string targetsFile = paths.outputDir + "/src/" + name + ".reflect";
+        if (cache && cache->fetch(classKeys[name], classFile) && cache->fetch(classKeys[name] + ".reflect", targetsFile)) {
+            continue;
+        }
+        pool.submit([&] {
+            const auto job = scheduler.submit(compileModule(module, paths, options, exports, stdio, trace));
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            assembled.emplace_back(module.name, job);
+        });
+    }
+    pool.wait();
+
+    std::vector<JobScheduler::Handle> classes;
+    for (const auto& [name, job] : assembled) {
+        classes.push_back(job);
+    }
+
+    // The jar or native image is queued behind the assembler jobs, so this script can be waiting for
+    // a native-image slot while another build is still assembling
+    JobScheduler::Handle packaged;
+    std::string failure;
+    if (options.jvm) {
+        packaged = packageJar(paths, modules, classes, options, stdio, scheduler);
+        failure = "Packaging " + paths.baseName + ".jar failed.";
+    } else {
+        NativeImageConfig::Targets targets;
+        for (const auto& name : names) {
+            NativeImageConfig::loadTargets(paths.outputDir + "/src/" + name + ".reflect", targets);
+        }
+        NativeImageConfig::write(targets, paths.configDir);
+
+        // A profiled class registers with Runtime/JayProfile in <clinit>, whose shutdown hook must be installed at run
+        // time, so profiled scripts are initialised when they start
+        std::string buildTimeClasses = "Types";
+        if (!options.profile) {
+            for (const auto& name : names) {
+                buildTimeClasses += "," + name;
+            }
+        }
+        packaged = scheduler.submit({ "native-image " + paths.baseName, "native-image",
+                                        { NATIVEIMAGEPATH, "-H:+UnlockExperimentalVMOptions",
+                                            "-H:ReflectionConfigurationFiles=" + paths.configDir + "/reflect-config.json",
+                                            "-H:ResourceConfigurationFiles=" + paths.configDir + "/resource-config.json",
+                                            "-H:SerializationConfigurationFiles=" + paths.configDir + "/serialization-config.json",
+                                            "-cp", paths.runtimeJar + ":" + paths.outputDir + "/src", paths.baseName,
+                                            "--initialize-at-build-time=" + buildTimeClasses, "-H:Name=" + paths.executable,
+                                            "--no-fallback" },
+                                        options.workingDirectory, stdio.in, stdio.out, stdio.err },
+            classes);
+        failure = "Native image generation failed.";
+    }
+
+    for (const auto& [name, job] : assembled) {
+        const auto& result = scheduler.wait(job);
+        traceJob(trace, "assemble", name, result);
+        check(result, "Compilation failed for " + name + ".");
+        if (cache) {
+            cache->store(classKeys.at(name), paths.outputDir + "/src/" + name + ".class");
+            cache->store(classKeys.at(name) + ".reflect", paths.outputDir + "/src/" + name + ".reflect");
+        }
+    }
+    if (packaged) {
+        const auto& result = scheduler.wait(packaged);
+        traceJob(trace, options.jvm ? "jar" : "native-image", paths.baseName, result);
+        check(result, failure);
+    }
+
+    if (options.jvm) {
+        const std::string jarFile = paths.outputDir + "/bin/" + paths.baseName + ".jar";
+        const std::string archiveFile = paths.outputDir + "/bin/" + paths.baseName + ".jsa";
+        return { "jvm", { JAVAPATH, "-XX:SharedArchiveFile=" + archiveFile, "-XX:+AutoCreateSharedArchive", "-cp", paths.runtimeJar + ":" + jarFile, paths.baseName } };
+    }
+    if (cache) {
+        cache->store(binaryKey, paths.executable);
+    }
+    return { "native", { paths.executable } };
+}
@@ -1,4 +1,6 @@
 #include "Expression.h"
+#include <charconv>
+#include <cmath>
 
 template <class... Ts>
 struct overloaded : Ts... {
@@ -31,6 +33,23 @@ std::ostream& operator<<(std::ostream& os, const Expr& expr)
     return os;
 };
 
+auto doubleText(const double d) -> std::string
+{
+    if (std::isinf(d)) {
+        return d < 0 ? "-Infinity" : "+Infinity";
+    }
+    if (std::isnan(d)) {
+        return "+NaN";
+    }
+    char buffer[32];
+    std::string text(buffer, std::to_chars(buffer, buffer + sizeof(buffer), d).ptr);
+    // Krakatau reads digits alone as an integer
+    if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
+
 std::string getLiteralType(const Expr& expr)
 {
     if (expr.type != ExprType::LITERAL) {
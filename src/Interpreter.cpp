@@ -0,0 +1,531 @@
+#include "Interpreter.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+
+/* A failure the JVM would report as an exception from JayLib; located by execute() */
+class JayError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/* Output is written once this much has been logged */
+static constexpr size_t flushSize = 64 << 10;
+
+/* Sums, differences and products of integers stay exact doubles below this; BigDecimal takes over beyond it */
+static constexpr double integerLimit = 0x1p53;
+
+/* BigDecimal.toString() of an integer with scale 0 */
+static void appendInteger(std::string& text, const double d)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.0f", d == 0 ? 0.0 : d);
+    text += buffer;
+}
+
+/* BigDecimal.intValue() of an integer: truncated, keeping the low 32 bits */
+static int32_t intValue(const double d)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(static_cast<int64_t>(d)));
+}
+
+/* Double.toString as of JDK 19: the shortest decimal that reads back as d (two digits at least, the closest such if
+ * one would do), plain from 10^-3 up to 10^7 and in computerized scientific notation otherwise */
+static std::string javaDoubleText(const double d)
+{
+    if (d == 0) {
+        return std::signbit(d) ? "-0.0" : "0.0";
+    }
+    char buffer[64];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::scientific).ptr;
+    if (std::find(buffer, end, 'e') - buffer <= (d < 0 ? 2 : 1)) {
+        end = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::scientific, 1).ptr;
+    }
+    const std::string_view text(buffer, end - buffer);
+    const size_t e = text.find('e');
+    const int exponent = std::atoi(std::string(text.substr(e + 1)).c_str());
+    std::string digits;
+    for (const char ch : text.substr(0, e)) {
+        if (ch >= '0' && ch <= '9') {
+            digits += ch;
+        }
+    }
+    while (digits.size() > 1 && digits.back() == '0') {
+        digits.pop_back();
+    }
+
+    std::string result = d < 0 ? "-" : "";
+    const double magnitude = std::fabs(d);
+    if (magnitude >= 1e-3 && magnitude < 1e7) {
+        if (exponent < 0) {
+            result += "0." + std::string(-exponent - 1, '0') + digits;
+        } else {
+            const auto integerDigits = static_cast<size_t>(exponent) + 1;
+            digits.resize(std::max(digits.size(), integerDigits), '0');
+            result += digits.substr(0, integerDigits) + ".";
+            result += digits.size() > integerDigits ? digits.substr(integerDigits) : "0";
+        }
+        return result;
+    }
+    result += digits.substr(0, 1) + "." + (digits.size() > 1 ? digits.substr(1) : "0");
+    return result + "E" + std::to_string(exponent);
+}
+
+Interpreter::Interpreter(const BytecodeProgram& program, const int out)
+    : program(program)
+    , out(out)
+    , globals(program.globals.size())
+    , initialized(program.modules.size())
+    , code(program.modules.size())
+    , constants(program.modules.size())
+    , lineBuffered(std::getenv("JAY_LOG_LINE_BUFFERED") != nullptr)
+{
+}
+
+Interpreter::~Interpreter()
+{
+    flush();
+}
+
+void Interpreter::run(const uint32_t module)
+{
+    initialized[module] = true;
+    execute(module);
+    flush();
+}
+
+void Interpreter::flush()
+{
+    size_t written = 0;
+    while (written < output.size()) {
+        const ssize_t n = ::write(out, output.data() + written, output.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    output.clear();
+}
+
+auto Interpreter::toDecimal(const Value value) -> Decimal
+{
+    return value.isInteger() ? Decimal::fromDouble(value.asInteger()) : *value.asDecimal();
+}
+
+auto Interpreter::number(Decimal value) -> Value
+{
+    // Keep every number the fast paths can handle as a double, so each number has a single representation
+    if (const auto integer = value.toInteger()) {
+        return Value::integer(*integer);
+    }
+    decimals.push_back(std::move(value));
+    return Value::decimal(&decimals.back());
+}
+
+void Interpreter::append(std::string& text, const Value value) const
+{
+    if (value.isInteger()) {
+        appendInteger(text, value.asInteger());
+    } else if (value.isDecimal()) {
+        value.asDecimal()->appendTo(text);
+    } else if (value.isString()) {
+        text += value.asString()->view();
+    } else if (value.isBool()) {
+        text += value.asBool() ? "true" : "false";
+    } else {
+        text += "nil";
+    }
+}
+
+auto Interpreter::add(const Value left, const Value right) -> Value
+{
+    if (left.isNumber() && right.isNumber()) {
+        return number(toDecimal(left).add(toDecimal(right)));
+    }
+    if (left.isString() || (left.isNumber() && right.isString())) {
+        scratch.clear();
+        append(scratch, left);
+        append(scratch, right);
+        return Value::string(strings.make(scratch));
+    }
+    throw JayError("Addition not supported for these types");
+}
+
+auto Interpreter::subtract(const Value left, const Value right) -> Value
+{
+    if (left.isNumber() && right.isNumber()) {
+        return number(toDecimal(left).subtract(toDecimal(right)));
+    }
+    if (left.isString() && right.isString()) {
+        const std::string_view text = left.asString()->view();
+        const std::string_view removed = right.asString()->view();
+        const size_t at = text.find(removed);
+        if (at == std::string_view::npos || removed.empty()) {
+            return left;
+        }
+        return Value::string(strings.concat(text.substr(0, at), text.substr(at + removed.size())));
+    }
+    throw JayError("Subtraction not supported for these types");
+}
+
+auto Interpreter::multiply(const Value left, const Value right) -> Value
+{
+    if (left.isNumber() && right.isNumber()) {
+        return number(toDecimal(left).multiply(toDecimal(right)));
+    }
+    const Value* text = left.isString() && right.isNumber() ? &left : left.isNumber() && right.isString() ? &right : nullptr;
+    if (text == nullptr) {
+        throw JayError("Multiplication not supported for these types");
+    }
+    const Value times = text == &left ? right : left;
+    const int32_t count = times.isInteger() ? intValue(times.asInteger()) : times.asDecimal()->intValue();
+    if (count < 0) {
+        throw JayError("count is negative: " + std::to_string(count));
+    }
+    scratch.clear();
+    for (int32_t i = 0; i < count; ++i) {
+        scratch += text->asString()->view();
+    }
+    return Value::string(strings.make(scratch));
+}
+
+auto Interpreter::divide(const Value left, const Value right) -> Value
+{
+    if (left.isNumber() && right.isNumber()) {
+        const Decimal dividend = toDecimal(left);
+        const Decimal divisor = toDecimal(right);
+        if (divisor.isZero()) {
+            throw JayError(dividend.isZero() ? "Division undefined" : "Division by zero");
+        }
+        return number(dividend.divide(divisor));
+    }
+    throw JayError("Division not supported for these types");
+}
+
+auto Interpreter::negate(const Value value) -> Value
+{
+    if (value.isInteger()) {
+        return Value::integer(-value.asInteger());
+    }
+    if (value.isDecimal()) {
+        return number(value.asDecimal()->negate());
+    }
+    if (value.isString()) {
+        // Reversed by code point, as StringBuilder.reverse keeps surrogate pairs together
+        const std::string_view text = value.asString()->view();
+        scratch.clear();
+        for (size_t end = text.size(); end > 0;) {
+            size_t start = end - 1;
+            while (start > 0 && (static_cast<unsigned char>(text[start]) & 0xc0) == 0x80) {
+                --start;
+            }
+            scratch.append(text.substr(start, end - start));
+            end = start;
+        }
+        return Value::string(strings.make(scratch));
+    }
+    throw JayError("Negation not supported for this type");
+}
+
+auto Interpreter::call(const Builtin builtin, const Value* args) -> Value
+{
+    // JayInterop passes numbers as Double, so only the double overloads match
+    const auto argument = [&](const size_t i, const char* method) {
+        if (!args[i].isNumber()) {
+            throw JayError(std::string("No matching method found: ") + method);
+        }
+        return args[i].isInteger() ? args[i].asInteger() : args[i].asDecimal()->toDouble();
+    };
+    // A Double result becomes new BigDecimal(Double.toString(result))
+    const auto result = [&](const double d) {
+        if (!std::isfinite(d)) {
+            throw JayError("Infinite or NaN");
+        }
+        return number(Decimal::parse(javaDoubleText(d)));
+    };
+
+    switch (builtin) {
+    case Builtin::ABS:
+        return result(std::fabs(argument(0, "abs")));
+    case Builtin::MAX: {
+        const double a = argument(0, "max");
+        const double b = argument(1, "max");
+        return result(a >= b ? a : b);
+    }
+    case Builtin::MIN: {
+        const double a = argument(0, "min");
+        const double b = argument(1, "min");
+        return result(a <= b ? a : b);
+    }
+    case Builtin::SQRT:
+        return result(std::sqrt(argument(0, "sqrt")));
+    case Builtin::FLOOR:
+        return result(std::floor(argument(0, "floor")));
+    case Builtin::CEIL:
+        return result(std::ceil(argument(0, "ceil")));
+    case Builtin::RINT:
+        return result(std::nearbyint(argument(0, "rint")));
+    case Builtin::SIGNUM: {
+        const double a = argument(0, "signum");
+        return result(a > 0 ? 1.0 : a < 0 ? -1.0 : a);
+    }
+    case Builtin::TO_RADIANS:
+        return result(argument(0, "toRadians") * 0.017453292519943295);
+    case Builtin::TO_DEGREES:
+        return result(argument(0, "toDegrees") * 57.29577951308232);
+    case Builtin::CONCAT:
+        if (!args[0].isString() || !args[1].isString()) {
+            throw JayError("No matching method found: concat");
+        }
+        return Value::string(strings.concat(args[0].asString()->view(), args[1].asString()->view()));
+    case Builtin::LENGTH: {
+        if (!args[0].isString()) {
+            throw JayError("No matching method found: length");
+        }
+        // UTF-16 code units: one per UTF-8 sequence, two for the four-byte ones outside the BMP
+        size_t units = 0;
+        for (const unsigned char ch : args[0].asString()->view()) {
+            units += (ch & 0xc0) != 0x80 ? 1 : 0;
+            units += ch >= 0xf0 ? 1 : 0;
+        }
+        return Value::integer(static_cast<double>(units));
+    }
+    }
+    throw JayError("Unknown builtin");
+}
+
+auto Interpreter::equal(const Value left, const Value right) -> bool
+{
+    if (left.isInteger() && right.isInteger()) {
+        return left.asInteger() == right.asInteger();
+    }
+    if (left.isNumber() || right.isNumber()) {
+        // BigDecimal.equals, which also compares scales
+        return left.isNumber() && right.isNumber() && toDecimal(left) == toDecimal(right);
+    }
+    if (left.isString() || right.isString()) {
+        return left.isString() && right.isString() && left.asString()->view() == right.asString()->view();
+    }
+    return left.identical(right);
+}
+
+auto Interpreter::compare(const Value left, const Value right) -> int
+{
+    if (left.isNumber()) {
+        if (!right.isNumber()) {
+            throw JayError("Type mismatch");
+        }
+        return toDecimal(left).compare(toDecimal(right));
+    }
+    if (left.isString()) {
+        if (!right.isString()) {
+            throw JayError("Type mismatch");
+        }
+        return left.asString()->view().compare(right.asString()->view());
+    }
+    throw JayError("Comparison not supported for this type");
+}
+
+void Interpreter::execute(const uint32_t module)
+{
+    // In Op order
+    static const void* const handlers[] = {
+        &&LOADK, &&MOVE, &&GETGLOBAL, &&SETGLOBAL,
+        &&ADD, &&SUB, &&MUL, &&DIV, &&EQ, &&NE, &&LT, &&LE, &&GT, &&GE,
+        &&NEG, &&NOT, &&JUMP, &&JUMPIF, &&JUMPIFNOT,
+        &&JUMPEQ, &&JUMPNE, &&JUMPLT, &&JUMPLE, &&JUMPGT, &&JUMPGE,
+        &&LOG, &&FLUSH, &&CALL, &&IMPORT, &&RETURN
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Op::COUNT));
+
+    const Chunk& chunk = program.modules[module];
+    if (code[module].empty()) {
+        for (const Instruction& instruction : chunk.code) {
+            code[module].push_back({ handlers[static_cast<size_t>(instruction.op)], instruction.a, instruction.b, instruction.c });
+        }
+        for (const Constant& constant : chunk.constants) {
+            constants[module].push_back(std::visit(
+                [this](const auto& value) {
+                    using T = std::decay_t<decltype(value)>;
+                    if constexpr (std::is_same_v<T, double>) {
+                        // The literal's exact value, as generateObject(double) gives it on the JVM
+                        return number(Decimal::fromDouble(value));
+                    } else if constexpr (std::is_same_v<T, std::string>) {
+                        return Value::string(strings.make(value));
+                    } else if constexpr (std::is_same_v<T, bool>) {
+                        return Value::boolean(value);
+                    } else {
+                        return Value::nil();
+                    }
+                },
+                constant));
+        }
+    }
+
+    std::vector<Value> registers(chunk.registers);
+    Value* r = registers.data();
+    const Value* k = constants[module].data();
+    const Threaded* start = code[module].data();
+    const Threaded* ip = start;
+
+#define NEXT() goto* (++ip)->handler
+#define JUMP_TO(target)         \
+    do {                        \
+        ip = start + (target);  \
+        goto* ip->handler;      \
+    } while (0)
+// Any other value is a NaN payload, and NaN fails the range check, so one test covers both operand types
+#define ARITHMETIC(op, slow)                                                                  \
+    {                                                                                         \
+        const Value left = r[ip->b];                                                          \
+        const Value right = r[ip->c];                                                         \
+        const double result = left.asInteger() op right.asInteger();                          \
+        r[ip->a] = std::fabs(result) < integerLimit ? Value::integer(result) : slow(left, right); \
+        NEXT();                                                                               \
+    }
+#define COMPARE(op)                                                                               \
+    (r[ip->a].isInteger() && r[ip->b].isInteger() ? r[ip->a].asInteger() op r[ip->b].asInteger() \
+                                                  : compare(r[ip->a], r[ip->b]) op 0)
+#define COMPARE_INTO(op)                                                                                   \
+    {                                                                                                      \
+        const Value left = r[ip->b];                                                                       \
+        const Value right = r[ip->c];                                                                      \
+        r[ip->a] = Value::boolean(left.isInteger() && right.isInteger() ? left.asInteger() op right.asInteger() \
+                                                                        : compare(left, right) op 0);      \
+        NEXT();                                                                                            \
+    }
+
+    try {
+        goto* ip->handler;
+
+    LOADK:
+        r[ip->a] = k[ip->b];
+        NEXT();
+    MOVE:
+        r[ip->a] = r[ip->b];
+        NEXT();
+    GETGLOBAL:
+        r[ip->a] = globals[ip->b];
+        NEXT();
+    SETGLOBAL:
+        globals[ip->a] = r[ip->b];
+        NEXT();
+    ADD:
+        ARITHMETIC(+, add)
+    SUB:
+        ARITHMETIC(-, subtract)
+    MUL:
+        ARITHMETIC(*, multiply)
+    DIV: {
+        // An integer quotient of integers is exact; anything else rounds the way BigDecimal does
+        const Value left = r[ip->b];
+        const Value right = r[ip->c];
+        r[ip->a] = left.isInteger() && right.isInteger() && right.asInteger() != 0
+                && std::fmod(left.asInteger(), right.asInteger()) == 0
+            ? Value::integer(left.asInteger() / right.asInteger())
+            : divide(left, right);
+        NEXT();
+    }
+    EQ:
+        r[ip->a] = Value::boolean(equal(r[ip->b], r[ip->c]));
+        NEXT();
+    NE:
+        r[ip->a] = Value::boolean(!equal(r[ip->b], r[ip->c]));
+        NEXT();
+    LT:
+        COMPARE_INTO(<)
+    LE:
+        COMPARE_INTO(<=)
+    GT:
+        COMPARE_INTO(>)
+    GE:
+        COMPARE_INTO(>=)
+    NEG:
+        r[ip->a] = negate(r[ip->b]);
+        NEXT();
+    NOT:
+        r[ip->a] = Value::boolean(!r[ip->b].isTruthy());
+        NEXT();
+    JUMP:
+        JUMP_TO(ip->a);
+    JUMPIF:
+        if (r[ip->a].isTruthy()) {
+            JUMP_TO(ip->b);
+        }
+        NEXT();
+    JUMPIFNOT:
+        if (!r[ip->a].isTruthy()) {
+            JUMP_TO(ip->b);
+        }
+        NEXT();
+    JUMPEQ:
+        if (equal(r[ip->a], r[ip->b])) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    JUMPNE:
+        if (!equal(r[ip->a], r[ip->b])) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    JUMPLT:
+        if (COMPARE(<)) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    JUMPLE:
+        if (COMPARE(<=)) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    JUMPGT:
+        if (COMPARE(>)) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    JUMPGE:
+        if (COMPARE(>=)) {
+            JUMP_TO(ip->c);
+        }
+        NEXT();
+    LOG:
+        append(output, r[ip->a]);
+        output += '\n';
+        if (output.size() >= flushSize || lineBuffered) {
+            flush();
+        }
+        NEXT();
+    FLUSH:
+        flush();
+        NEXT();
+    CALL:
+        r[ip->a] = call(static_cast<Builtin>(ip->b), r + ip->c);
+        NEXT();
+    IMPORT:
+        // Guarded like a module class's run()
+        if (!initialized[ip->a]) {
+            initialized[ip->a] = true;
+            execute(ip->a);
+        }
+        NEXT();
+    RETURN:
+        return;
+    } catch (const JayError& e) {
+        flush();
+        throw std::runtime_error(chunk.name + ".jay:" + std::to_string(chunk.lines[ip - start]) + ": " + e.what());
+    }
+
+#undef NEXT
+#undef JUMP_TO
+#undef ARITHMETIC
+#undef COMPARE
+#undef COMPARE_INTO
+}
@@ -0,0 +1,171 @@
+#include "JobScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+extern char** environ;
+
+/* Held from creating a job's pipe until its child exists, so no other child inherits the write end
+ * and keeps the pipe open after the tool exits */
+static std::mutex spawnMutex;
+
+JobScheduler::JobScheduler(std::map<std::string, size_t> limits)
+    : limits(std::move(limits))
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    changed.wait(lock, [this] { return active == 0; });
+}
+
+auto JobScheduler::submit(Job job, std::vector<Handle> dependencies) -> Handle
+{
+    auto entry = std::make_shared<Entry>();
+    entry->job = std::move(job);
+    entry->dependencies = std::move(dependencies);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(entry);
+    dispatch();
+    return entry;
+}
+
+auto JobScheduler::wait(const Handle& job) -> const Result&
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return job->finished; });
+    return job->result;
+}
+
+auto JobScheduler::nativeImageSlots() -> size_t
+{
+    constexpr size_t coresPerBuild = 4;
+    constexpr long long bytesPerBuild = 4LL << 30;
+
+    const size_t byCores = std::thread::hardware_concurrency() / coresPerBuild;
+    const long long pages = sysconf(_SC_PHYS_PAGES);
+    const long long pageSize = sysconf(_SC_PAGE_SIZE);
+    const size_t byMemory = pages > 0 && pageSize > 0 ? static_cast<size_t>(pages * pageSize / bytesPerBuild) : 1;
+    return std::max<size_t>(1, std::min(byCores, byMemory));
+}
+
+/* Called with the lock held: settles jobs whose dependencies failed and starts every job that can run */
+void JobScheduler::dispatch()
+{
+    bool progress = true;
+    while (progress && !stopping) {
+        progress = false;
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            const Handle job = *it;
+            bool ready = true;
+            bool failed = false;
+            for (const auto& dependency : job->dependencies) {
+                ready = ready && dependency->finished;
+                failed = failed || (dependency->finished && !dependency->result.succeeded());
+            }
+
+            if (failed) {
+                job->result.skipped = true;
+                job->finished = true;
+            } else if (ready) {
+                const auto limit = limits.find(job->job.pool);
+                if (limit != limits.end() && running[job->job.pool] >= limit->second) {
+                    continue;
+                }
+                running[job->job.pool]++;
+                active++;
+                std::thread([this, job] { execute(job); }).detach();
+            } else {
+                continue;
+            }
+
+            // A settled job can unblock or fail others already passed over, so scan again
+            pending.erase(it);
+            progress = true;
+            break;
+        }
+    }
+    changed.notify_all();
+}
+
+void JobScheduler::execute(const Handle& entry)
+{
+    const Job& job = entry->job;
+    Result result;
+    result.start = std::chrono::steady_clock::now();
+
+    std::vector<char*> argv;
+    for (const auto& arg : job.argv) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    const std::string directory = job.workingDirectory.string();
+
+    int output[2] = { -1, -1 };
+    pid_t pid = -1;
+    {
+        std::lock_guard<std::mutex> lock(spawnMutex);
+        if (job.capture && pipe(output) == 0) {
+            fcntl(output[0], F_SETFD, FD_CLOEXEC);
+            fcntl(output[1], F_SETFD, FD_CLOEXEC);
+        }
+        const int out = job.capture ? output[1] : job.out;
+        const int err = job.capture ? output[1] : job.err;
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addchdir_np(&actions, directory.c_str());
+        posix_spawn_file_actions_adddup2(&actions, job.in, STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, err, STDERR_FILENO);
+        if (out < 0 || posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) {
+            pid = -1;
+        }
+        posix_spawn_file_actions_destroy(&actions);
+        if (output[1] >= 0) {
+            close(output[1]);
+        }
+    }
+
+    if (pid < 0) {
+        result.status = 127;
+        result.output = "Failed to start " + job.argv.front() + "\n";
+    } else {
+        if (output[0] >= 0) {
+            char buffer[4096];
+            ssize_t n;
+            while ((n = read(output[0], buffer, sizeof(buffer))) != 0) {
+                if (n > 0) {
+                    result.output.append(buffer, n);
+                } else if (errno != EINTR) {
+                    break;
+                }
+            }
+        }
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+        result.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if (output[0] >= 0) {
+        close(output[0]);
+    }
+
+    result.end = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(result.end - result.start);
+    const std::string report = "[jj] " + job.name + " took " + std::to_string(elapsed.count()) + " ms\n";
+    (void)!write(job.err, report.data(), report.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entry->result = std::move(result);
+    entry->finished = true;
+    running[job.pool]--;
+    active--;
+    dispatch();
+}
@@ -1,27 +1,64 @@
 #include "Linker.h"
-#include <fstream>
 #include <stdexcept>
 
-Linker::Linker(const std::string &className) {
-    code = ".class public " + className + "\n"
-           ".super java/lang/Object\n"
-           ".method public static main : ([Ljava/lang/String;)V\n"
-           ".code stack 100 locals 10\n";
+Linker::Linker(const std::string &className, const std::string &filename, size_t locals)
+    : className(className)
+    , buffer(bufferSize) {
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    // The script body is run(), guarded so importing a module more than once only runs it once
+    file << ".class public " << className << "\n"
+         << ".super java/lang/Object\n"
+         << ".sourcefile \"" << className << ".jay\"\n"
+         << ".field private static $initialized Z\n"
+         << ".method public static run : ()V\n"
+         << ".code stack 100 locals " << locals << "\n"
+         << "getstatic " << className << "/$initialized Z\n"
+         << "ifeq Lrun\n"
+         << "return\n"
+         << "Lrun:\n"
+         << "iconst_1\n"
+         << "putstatic " << className << "/$initialized Z\n";
 }
 
 void Linker::addCode(const std::string &code) {
-    this->code += code;
+    file << code;
 }
 
-void Linker::writeToFile(const std::string &filename) const {
-    std::ofstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file for writing.");
-    }
-    file << code << "\n"
+void Linker::addConstants(const std::string &fields, const std::string &initializer) {
+    this->fields += fields;
+    this->initializer += initializer;
+}
+
+void Linker::close() {
+    file << "\n"
+         << ".end code\n"
+         << ".end method\n";
+
+    file << ".method public static main : ([Ljava/lang/String;)V\n"
+         << ".code stack 0 locals 1\n"
+         << "invokestatic " << className << "/run()V\n"
+         << "return\n"
          << ".end code\n"
-         << ".end method\n"
-         << ".end class\n";
+         << ".end method\n";
+
+    // Class members may follow the methods, so the literal pool goes last
+    file << fields;
+    if (!initializer.empty()) {
+        file << ".method static <clinit> : ()V\n"
+             << ".code stack 2 locals 0\n"
+             << initializer
+             << "return\n"
+             << ".end code\n"
+             << ".end method\n";
+    }
+    file << ".end class\n";
 
     file.close();
-}
\ No newline at end of file
+    if (file.fail()) {
+        throw std::runtime_error("Failed to write assembly file.");
+    }
+}
@@ -0,0 +1,351 @@
+#include "LoopInvariants.h"
+#include "Statement.h"
+#include "statementTypes.h"
+
+template <class... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+template <class... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+std::vector<std::shared_ptr<Expr>> LoopInvariants::find(const While& loop)
+{
+    // The condition is re-evaluated every pass, so its writes vary just like the body's
+    auto assigned = assignedVariables(*loop.body);
+    collectAssigned(*loop.condition, assigned);
+    std::vector<std::shared_ptr<Expr>> out;
+    // The preheader guard evaluates the whole condition first, so anything it would throw has already been thrown
+    bool effects = false;
+    collectHoistable(loop.condition, assigned, out, effects);
+    effects = false;
+    collectHoistable(*loop.body, assigned, out, effects);
+    return out;
+}
+
+std::unordered_set<std::string> LoopInvariants::assignedVariables(const Statement& body)
+{
+    std::unordered_set<std::string> assigned;
+    collectAssigned(body, assigned);
+    return assigned;
+}
+
+bool LoopInvariants::isPureCall(const Call& call)
+{
+    const auto* callee = std::get_if<Variable>(&call.callee->content);
+    if (callee == nullptr || callee->name.getLexeme() != "JavaStaticCall" || call.args.size() < 2) {
+        return false;
+    }
+    const auto* className = std::get_if<Literal>(&call.args[0]->content);
+    const auto* methodName = std::get_if<Literal>(&call.args[1]->content);
+    if (className == nullptr || methodName == nullptr
+        || !std::holds_alternative<std::string>(className->literal)
+        || !std::holds_alternative<std::string>(methodName->literal)) {
+        return false;
+    }
+    // String literals keep their quotes
+    const auto& cls = std::get<std::string>(className->literal);
+    const auto& method = std::get<std::string>(methodName->literal);
+    return (cls == "\"java.lang.Math\"" || cls == "\"java.lang.StrictMath\"") && method != "\"random\"";
+}
+
+static bool isNumberLiteral(const Expr& expr)
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return isNumberLiteral(*g->expression);
+    }
+    const auto* literal = std::get_if<Literal>(&expr.content);
+    return literal != nullptr && std::holds_alternative<double>(literal->literal);
+}
+
+static bool isStringLiteral(const Expr& expr)
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return isStringLiteral(*g->expression);
+    }
+    const auto* literal = std::get_if<Literal>(&expr.content);
+    return literal != nullptr && std::holds_alternative<std::string>(literal->literal);
+}
+
+static bool isNonZeroLiteral(const Expr& expr)
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return isNonZeroLiteral(*g->expression);
+    }
+    const auto* literal = std::get_if<Literal>(&expr.content);
+    return literal != nullptr && std::holds_alternative<double>(literal->literal)
+        && std::get<double>(literal->literal) != 0;
+}
+
+bool LoopInvariants::cannotThrow(const Expr& expr)
+{
+    // Arithmetic and ordering throw on mismatched types, so only literal operands are known to be safe
+    return std::visit(overloaded {
+                          [&](const Literal&) { return true; },
+                          [&](const Variable&) { return true; },
+                          [&](const Grouping& g) { return cannotThrow(*g.expression); },
+                          [&](const Unary& u) {
+                              if (u.opr.type == TokenType::BANG) {
+                                  return cannotThrow(*u.value);
+                              }
+                              return isNumberLiteral(*u.value) || isStringLiteral(*u.value);
+                          },
+                          [&](const Binary& b) {
+                              const bool numbers = isNumberLiteral(*b.left) && isNumberLiteral(*b.right);
+                              switch (b.opr.type) {
+                              case TokenType::EQUAL_EQUAL:
+                              case TokenType::BANG_EQUAL:
+                                  return cannotThrow(*b.left) && cannotThrow(*b.right);
+                              case TokenType::PLUS:
+                                  // Strings concatenate with anything, and numbers with strings
+                                  return numbers || (isStringLiteral(*b.left) && cannotThrow(*b.right))
+                                      || (isNumberLiteral(*b.left) && isStringLiteral(*b.right));
+                              case TokenType::MINUS:
+                              case TokenType::STAR:
+                                  return numbers;
+                              case TokenType::SLASH:
+                                  return numbers && isNonZeroLiteral(*b.right);
+                              case TokenType::GREATER:
+                              case TokenType::GREATER_EQUAL:
+                              case TokenType::LESS:
+                              case TokenType::LESS_EQUAL:
+                                  return numbers || (isStringLiteral(*b.left) && isStringLiteral(*b.right));
+                              default:
+                                  return false;
+                              }
+                          },
+                          [&](const Logical& l) { return cannotThrow(*l.left) && cannotThrow(*l.right); },
+                          [&](const Ternary& t) {
+                              return cannotThrow(*t.condition) && cannotThrow(*t.left) && cannotThrow(*t.right);
+                          },
+                          [&](const Call& c) {
+                              if (!isPureCall(c)) {
+                                  return false;
+                              }
+                              // Interop rejects arguments the Java method does not accept
+                              for (size_t i = 2; i < c.args.size(); ++i) {
+                                  if (!isNumberLiteral(*c.args[i])) {
+                                      return false;
+                                  }
+                              }
+                              return true;
+                          },
+                          [&](const Assign& a) { return cannotThrow(*a.value); } },
+        expr.content);
+}
+
+void LoopInvariants::collectAssigned(const Statement& stmt, std::unordered_set<std::string>& assigned)
+{
+    std::visit(overloaded {
+                   [&](const ExprStatement& es) { collectAssigned(*es.expression, assigned); },
+                   [&](const PrintStatement& ps) { collectAssigned(*ps.expression, assigned); },
+                   [&](const JJStatement& js) {
+                       assigned.insert(js.name.getLexeme());
+                       collectAssigned(*js.value, assigned);
+                   },
+                   [&](const Block& b) {
+                       for (const auto& s : b.statements) {
+                           collectAssigned(*s, assigned);
+                       }
+                   },
+                   [&](const IfStatement& i) {
+                       collectAssigned(*i.condition, assigned);
+                       collectAssigned(*i.ifBlock, assigned);
+                       if (i.elseBlock != nullptr) {
+                           collectAssigned(*i.elseBlock, assigned);
+                       }
+                   },
+                   [&](const While& w) {
+                       collectAssigned(*w.condition, assigned);
+                       collectAssigned(*w.body, assigned);
+                   },
+                   [&](const Function&) {},
+                   [&](const Import&) {} },
+        stmt.content);
+}
+
+void LoopInvariants::collectAssigned(const Expr& expr, std::unordered_set<std::string>& assigned)
+{
+    std::visit(overloaded {
+                   [&](const Assign& a) {
+                       assigned.insert(a.name.getLexeme());
+                       collectAssigned(*a.value, assigned);
+                   },
+                   [&](const Binary& b) {
+                       collectAssigned(*b.left, assigned);
+                       collectAssigned(*b.right, assigned);
+                   },
+                   [&](const Logical& l) {
+                       collectAssigned(*l.left, assigned);
+                       collectAssigned(*l.right, assigned);
+                   },
+                   [&](const Unary& u) { collectAssigned(*u.value, assigned); },
+                   [&](const Grouping& g) { collectAssigned(*g.expression, assigned); },
+                   [&](const Ternary& t) {
+                       collectAssigned(*t.condition, assigned);
+                       collectAssigned(*t.left, assigned);
+                       collectAssigned(*t.right, assigned);
+                   },
+                   [&](const Call& c) {
+                       for (const auto& arg : c.args) {
+                           collectAssigned(*arg, assigned);
+                       }
+                   },
+                   [&](const auto&) {} },
+        expr.content);
+}
+
+bool LoopInvariants::isInvariant(const Expr& expr, const std::unordered_set<std::string>& assigned)
+{
+    return std::visit(overloaded {
+                          [&](const Literal&) { return true; },
+                          [&](const Variable& v) { return assigned.count(v.name.getLexeme()) == 0; },
+                          [&](const Grouping& g) { return isInvariant(*g.expression, assigned); },
+                          [&](const Unary& u) { return isInvariant(*u.value, assigned); },
+                          [&](const Binary& b) { return isInvariant(*b.left, assigned) && isInvariant(*b.right, assigned); },
+                          [&](const Logical& l) { return isInvariant(*l.left, assigned) && isInvariant(*l.right, assigned); },
+                          [&](const Ternary& t) {
+                              return isInvariant(*t.condition, assigned) && isInvariant(*t.left, assigned)
+                                  && isInvariant(*t.right, assigned);
+                          },
+                          [&](const Call& c) {
+                              if (!isPureCall(c)) {
+                                  return false;
+                              }
+                              for (size_t i = 2; i < c.args.size(); ++i) {
+                                  if (!isInvariant(*c.args[i], assigned)) {
+                                      return false;
+                                  }
+                              }
+                              return true;
+                          },
+                          [&](const Assign&) { return false; } },
+        expr.content);
+}
+
+bool LoopInvariants::isWorthHoisting(const Expr& expr)
+{
+    // Literals are already pooled and variables are a single aload
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return isWorthHoisting(*g->expression);
+    }
+    return !std::holds_alternative<Literal>(expr.content) && !std::holds_alternative<Variable>(expr.content);
+}
+
+bool LoopInvariants::hasEffects(const Expr& expr)
+{
+    // Writes to variables are not observable once an error ends the program; output and interop calls are
+    return std::visit(overloaded {
+                          [&](const Assign& a) { return hasEffects(*a.value); },
+                          [&](const Binary& b) { return hasEffects(*b.left) || hasEffects(*b.right); },
+                          [&](const Logical& l) { return hasEffects(*l.left) || hasEffects(*l.right); },
+                          [&](const Unary& u) { return hasEffects(*u.value); },
+                          [&](const Grouping& g) { return hasEffects(*g.expression); },
+                          [&](const Ternary& t) {
+                              return hasEffects(*t.condition) || hasEffects(*t.left) || hasEffects(*t.right);
+                          },
+                          [&](const Call& c) {
+                              if (!isPureCall(c)) {
+                                  return true;
+                              }
+                              for (const auto& arg : c.args) {
+                                  if (hasEffects(*arg)) {
+                                      return true;
+                                  }
+                              }
+                              return false;
+                          },
+                          [&](const auto&) { return false; } },
+        expr.content);
+}
+
+bool LoopInvariants::hasEffects(const Statement& stmt)
+{
+    return std::visit(overloaded {
+                          [&](const ExprStatement& es) { return hasEffects(*es.expression); },
+                          [&](const PrintStatement&) { return true; },
+                          [&](const JJStatement& js) { return hasEffects(*js.value); },
+                          [&](const Block& b) {
+                              for (const auto& s : b.statements) {
+                                  if (hasEffects(*s)) {
+                                      return true;
+                                  }
+                              }
+                              return false;
+                          },
+                          [&](const IfStatement& i) {
+                              return hasEffects(*i.condition) || hasEffects(*i.ifBlock)
+                                  || (i.elseBlock != nullptr && hasEffects(*i.elseBlock));
+                          },
+                          [&](const While& w) { return hasEffects(*w.condition) || hasEffects(*w.body); },
+                          [&](const Function&) { return false; },
+                          [&](const Import&) { return true; } },
+        stmt.content);
+}
+
+void LoopInvariants::collectHoistable(const std::shared_ptr<Expr>& expr, const std::unordered_set<std::string>& assigned,
+    std::vector<std::shared_ptr<Expr>>& out, bool& effects)
+{
+    if (isInvariant(*expr, assigned)) {
+        // Hoisting an expression that may throw past earlier output would lose that output
+        if (isWorthHoisting(*expr) && (!effects || cannotThrow(*expr))) {
+            out.push_back(expr);
+        }
+        return;
+    }
+
+    // Only descend into operands evaluated on every pass, never into short-circuited ones
+    std::visit(overloaded {
+                   [&](const Binary& b) {
+                       collectHoistable(b.left, assigned, out, effects);
+                       collectHoistable(b.right, assigned, out, effects);
+                   },
+                   [&](const Unary& u) { collectHoistable(u.value, assigned, out, effects); },
+                   [&](const Grouping& g) { collectHoistable(g.expression, assigned, out, effects); },
+                   [&](const Assign& a) { collectHoistable(a.value, assigned, out, effects); },
+                   [&](const Logical& l) {
+                       collectHoistable(l.left, assigned, out, effects);
+                       effects = effects || hasEffects(*l.right);
+                   },
+                   [&](const Ternary& t) {
+                       collectHoistable(t.condition, assigned, out, effects);
+                       effects = effects || hasEffects(*t.left) || hasEffects(*t.right);
+                   },
+                   [&](const Call& c) {
+                       for (size_t i = 2; i < c.args.size(); ++i) {
+                           collectHoistable(c.args[i], assigned, out, effects);
+                       }
+                       effects = effects || hasEffects(*c.callee) || !isPureCall(c);
+                   },
+                   [&](const auto&) {} },
+        expr->content);
+}
+
+void LoopInvariants::collectHoistable(const Statement& stmt, const std::unordered_set<std::string>& assigned,
+    std::vector<std::shared_ptr<Expr>>& out, bool& effects)
+{
+    std::visit(overloaded {
+                   [&](const ExprStatement& es) { collectHoistable(es.expression, assigned, out, effects); },
+                   [&](const PrintStatement& ps) {
+                       collectHoistable(ps.expression, assigned, out, effects);
+                       effects = true;
+                   },
+                   [&](const JJStatement& js) { collectHoistable(js.value, assigned, out, effects); },
+                   [&](const Block& b) {
+                       for (const auto& s : b.statements) {
+                           collectHoistable(*s, assigned, out, effects);
+                       }
+                   },
+                   [&](const IfStatement& i) {
+                       collectHoistable(i.condition, assigned, out, effects);
+                       effects = effects || hasEffects(*i.ifBlock) || (i.elseBlock != nullptr && hasEffects(*i.elseBlock));
+                   },
+                   [&](const While& w) {
+                       collectHoistable(w.condition, assigned, out, effects);
+                       effects = effects || hasEffects(*w.body);
+                   },
+                   [&](const Function&) {},
+                   [&](const Import&) { effects = true; } },
+        stmt.content);
+}
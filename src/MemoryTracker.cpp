@@ -0,0 +1,162 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static constexpr int categories = static_cast<int>(MemoryTracker::Category::COUNT);
+static const char* const categoryNames[categories] = { "other", "tokens", "ast", "optimizer", "symbols", "code", "link" };
+
+/* Constant-initialized, so allocations made before main are counted safely */
+static thread_local MemoryTracker::Category current = MemoryTracker::Category::OTHER;
+
+struct Counters {
+    std::atomic<int64_t> allocations { 0 };
+    std::atomic<int64_t> allocated { 0 };
+    std::atomic<int64_t> live { 0 };
+    std::atomic<int64_t> peak { 0 };
+};
+static Counters counters[categories];
+static Counters total;
+
+MemoryTracker::Scope::Scope(Category category)
+    : previous(current)
+{
+    current = category;
+}
+
+MemoryTracker::Scope::~Scope()
+{
+    current = previous;
+}
+
+auto MemoryTracker::enabled() -> bool
+{
+#ifdef JAY_MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+auto MemoryTracker::report() -> std::string
+{
+    const auto mib = [](const std::atomic<int64_t>& bytes) { return static_cast<double>(bytes.load()) / (1 << 20); };
+
+    std::string out;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-10s %12s %14s %10s %10s\n", "memory", "allocs", "allocated MiB", "live MiB", "peak MiB");
+    out += line;
+    for (int i = 0; i < categories; ++i) {
+        std::snprintf(line, sizeof(line), "%-10s %12lld %14.2f %10.2f %10.2f\n", categoryNames[i],
+            static_cast<long long>(counters[i].allocations.load()), mib(counters[i].allocated), mib(counters[i].live), mib(counters[i].peak));
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%-10s %12lld %14.2f %10.2f %10.2f\n", "total",
+        static_cast<long long>(total.allocations.load()), mib(total.allocated), mib(total.live), mib(total.peak));
+    out += line;
+    return out;
+}
+
+#ifdef JAY_MEMORY_TRACKING
+
+static void raisePeak(std::atomic<int64_t>& peak, int64_t value)
+{
+    int64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) { }
+}
+
+static void count(Counters& c, int64_t bytes)
+{
+    if (bytes > 0) {
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.allocated.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    raisePeak(c.peak, c.live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+/* Prefixed to every allocation; keeps the default new alignment for the memory after it */
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+    size_t size;
+    MemoryTracker::Category category;
+};
+
+static void* allocate(size_t size)
+{
+    auto* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = size;
+    header->category = current;
+    count(counters[static_cast<int>(current)], static_cast<int64_t>(size));
+    count(total, static_cast<int64_t>(size));
+    return header + 1;
+}
+
+static void release(void* pointer)
+{
+    if (!pointer) {
+        return;
+    }
+    Header* header = static_cast<Header*>(pointer) - 1;
+    count(counters[static_cast<int>(header->category)], -static_cast<int64_t>(header->size));
+    count(total, -static_cast<int64_t>(header->size));
+    std::free(header);
+}
+
+void* operator new(size_t size)
+{
+    if (void* pointer = allocate(size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    release(pointer);
+}
+
+#endif
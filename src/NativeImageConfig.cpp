@@ -0,0 +1,72 @@
+#include "NativeImageConfig.h"
+#include <fstream>
+#include <stdexcept>
+
+void NativeImageConfig::saveTargets(const Targets& targets, const std::filesystem::path& file)
+{
+    std::ofstream out { file };
+    for (const auto& [cls, methods] : targets) {
+        for (const auto& method : methods) {
+            out << cls << ' ' << method << '\n';
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write " + file.string());
+    }
+}
+
+void NativeImageConfig::loadTargets(const std::filesystem::path& file, Targets& targets)
+{
+    std::ifstream in { file };
+    if (!in) {
+        throw std::runtime_error("Failed to read " + file.string());
+    }
+    std::string cls, method;
+    while (in >> cls >> method) {
+        targets[cls].insert(method);
+    }
+}
+
+std::string NativeImageConfig::quote(const std::string& text)
+{
+    std::string out = "\"";
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+void NativeImageConfig::write(const Targets& targets, const std::filesystem::path& directory)
+{
+    std::filesystem::create_directories(directory);
+
+    // Every call goes through JayInterop.callMethod, which the bootstrap method looks up by handle
+    std::ofstream reflect { directory / "reflect-config.json" };
+    reflect << "[\n"
+            << "  {\n"
+            << "    \"name\": \"Interop.JayInterop\",\n"
+            << "    \"methods\": [{ \"name\": \"callMethod\", \"parameterTypes\": [\"java.lang.String\", \"java.lang.String\", \"java.lang.Object[]\"] }]\n"
+            << "  }";
+    for (const auto& [cls, methods] : targets) {
+        // No parameter types: the overload is picked at run time from the argument classes, so every
+        // overload of the name is registered
+        reflect << ",\n  {\n    \"name\": " << quote(cls) << ",\n    \"methods\": [";
+        bool first = true;
+        for (const auto& method : methods) {
+            reflect << (first ? "" : ", ") << "{ \"name\": " << quote(method) << " }";
+            first = false;
+        }
+        reflect << "]\n  }";
+    }
+    reflect << "\n]\n";
+
+    std::ofstream { directory / "resource-config.json" } << "{\n  \"resources\": { \"includes\": [] }\n}\n";
+    std::ofstream { directory / "serialization-config.json" } << "[]\n";
+
+    if (!reflect) {
+        throw std::runtime_error("Failed to write native-image configuration to " + directory.string());
+    }
+}
@@ -0,0 +1,600 @@
+#include "Optimizer.h"
+#include "LoopInvariants.h"
+#include "Statement.h"
+#include "statementTypes.h"
+#include <algorithm>
+
+template <class... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+template <class... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+void Optimizer::optimize(std::vector<std::shared_ptr<Statement>>& program)
+{
+    if (level <= 0) {
+        return;
+    }
+
+    resolve(program);
+    scopes.emplace_back();
+    propagate(program);
+    scopes.clear();
+
+    // Removing one dead store can leave the variables it read dead as well
+    do {
+        resolve(program);
+    } while (eliminateDeadCode(program));
+
+    if (level >= 2) {
+        numberValues(program);
+    }
+}
+
+std::optional<size_t> Optimizer::lookup(const std::string& name) const
+{
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) {
+            return found->second;
+        }
+    }
+    return std::nullopt;
+}
+
+auto Optimizer::resolve(const std::vector<std::shared_ptr<Statement>>& program) -> void
+{
+    declarations.clear();
+    references.clear();
+    definitions.clear();
+    scopes.clear();
+    scopes.emplace_back();
+    for (const auto& stmt : program) {
+        if (stmt != nullptr) {
+            resolve(*stmt);
+        }
+    }
+    scopes.clear();
+}
+
+auto Optimizer::resolve(const Statement& stmt) -> void
+{
+    std::visit(overloaded {
+                   [&](const ExprStatement& es) { resolve(*es.expression); },
+                   [&](const PrintStatement& ps) { resolve(*ps.expression); },
+                   [&](const JJStatement& js) {
+                       // The initializer is evaluated before the name is in scope
+                       resolve(*js.value);
+                       const size_t id = declarations.size();
+                       declarations.push_back({ js.name.getLexeme(), js.name.line });
+                       if (exportsGlobals && scopes.size() == 1) {
+                           // Other modules may read and write it
+                           declarations[id].reads++;
+                           declarations[id].writes++;
+                       }
+                       scopes.back()[js.name.getLexeme()] = id;
+                       definitions[&stmt] = id;
+                   },
+                   [&](const Block& b) {
+                       scopes.emplace_back();
+                       for (const auto& s : b.statements) {
+                           if (s != nullptr) {
+                               resolve(*s);
+                           }
+                       }
+                       scopes.pop_back();
+                   },
+                   [&](const IfStatement& i) {
+                       resolve(*i.condition);
+                       resolve(*i.ifBlock);
+                       if (i.elseBlock != nullptr) {
+                           resolve(*i.elseBlock);
+                       }
+                   },
+                   [&](const While& w) {
+                       resolve(*w.condition);
+                       resolve(*w.body);
+                   },
+                   [&](const Function&) {},
+                   [&](const Import&) {} },
+        stmt.content);
+}
+
+auto Optimizer::resolve(const Expr& expr) -> void
+{
+    std::visit(overloaded {
+                   [&](const Variable& v) {
+                       if (auto id = lookup(v.name.getLexeme())) {
+                           references[&expr] = *id;
+                           declarations[*id].reads++;
+                       }
+                   },
+                   [&](const Assign& a) {
+                       resolve(*a.value);
+                       if (auto id = lookup(a.name.getLexeme())) {
+                           references[&expr] = *id;
+                           declarations[*id].writes++;
+                       }
+                   },
+                   [&](const Binary& b) {
+                       resolve(*b.left);
+                       resolve(*b.right);
+                   },
+                   [&](const Logical& l) {
+                       resolve(*l.left);
+                       resolve(*l.right);
+                   },
+                   [&](const Unary& u) { resolve(*u.value); },
+                   [&](const Grouping& g) { resolve(*g.expression); },
+                   [&](const Ternary& t) {
+                       resolve(*t.condition);
+                       resolve(*t.left);
+                       resolve(*t.right);
+                   },
+                   [&](const Call& c) {
+                       for (const auto& arg : c.args) {
+                           resolve(*arg);
+                       }
+                   },
+                   [&](const Literal&) {} },
+        expr.content);
+}
+
+auto Optimizer::propagate(std::vector<std::shared_ptr<Statement>>& statements) -> void
+{
+    for (auto& stmt : statements) {
+        if (stmt != nullptr) {
+            propagate(*stmt);
+        }
+    }
+}
+
+auto Optimizer::propagate(Statement& stmt) -> void
+{
+    std::visit(overloaded {
+                   [&](ExprStatement& es) { propagate(es.expression); },
+                   [&](PrintStatement& ps) { propagate(ps.expression); },
+                   [&](JJStatement& js) {
+                       propagate(js.value);
+                       const size_t id = definitions.at(&stmt);
+                       auto& declaration = declarations[id];
+                       if (std::holds_alternative<Literal>(js.value->content)) {
+                           declaration.constant = js.value;
+                       } else if (auto source = references.find(js.value.get());
+                                  source != references.end() && std::holds_alternative<Variable>(js.value->content)
+                                  && declarations[source->second].writes == 0) {
+                           declaration.copyOf = source->second;
+                       }
+                       scopes.back()[js.name.getLexeme()] = id;
+                   },
+                   [&](Block& b) {
+                       scopes.emplace_back();
+                       propagate(b.statements);
+                       scopes.pop_back();
+                   },
+                   [&](IfStatement& i) {
+                       propagate(i.condition);
+                       propagate(*i.ifBlock);
+                       if (i.elseBlock != nullptr) {
+                           propagate(*i.elseBlock);
+                       }
+                   },
+                   [&](While& w) {
+                       propagate(w.condition);
+                       propagate(*w.body);
+                   },
+                   [&](Function&) {},
+                   [&](Import&) {} },
+        stmt.content);
+}
+
+auto Optimizer::propagate(std::shared_ptr<Expr>& expr) -> void
+{
+    std::visit(overloaded {
+                   [&](Variable&) {
+                       auto it = references.find(expr.get());
+                       if (it == references.end() || declarations[it->second].writes != 0) {
+                           return;
+                       }
+                       const auto& declaration = declarations[it->second];
+                       if (declaration.constant != nullptr || declaration.copyOf) {
+                           references.erase(it);
+                       }
+                       if (declaration.constant != nullptr) {
+                           const auto& literal = std::get<Literal>(declaration.constant->content);
+                           expr = std::make_shared<Expr>(ExprType::LITERAL, Literal { literal.literal });
+                       } else if (declaration.copyOf) {
+                           // The source may be shadowed at this use; only rewrite if it still resolves to it
+                           const size_t source = *declaration.copyOf;
+                           if (lookup(declarations[source].name) == source) {
+                               expr = makeVariable(source);
+                           }
+                       }
+                   },
+                   [&](Assign& a) { propagate(a.value); },
+                   [&](Binary& b) {
+                       propagate(b.left);
+                       propagate(b.right);
+                   },
+                   [&](Logical& l) {
+                       propagate(l.left);
+                       propagate(l.right);
+                   },
+                   [&](Unary& u) { propagate(u.value); },
+                   [&](Grouping& g) { propagate(g.expression); },
+                   [&](Ternary& t) {
+                       propagate(t.condition);
+                       propagate(t.left);
+                       propagate(t.right);
+                   },
+                   [&](Call& c) {
+                       for (auto& arg : c.args) {
+                           propagate(arg);
+                       }
+                   },
+                   [&](Literal&) {} },
+        expr->content);
+}
+
+auto Optimizer::eliminateDeadCode(std::vector<std::shared_ptr<Statement>>& statements) -> bool
+{
+    const size_t before = statements.size();
+    statements.erase(std::remove_if(statements.begin(), statements.end(),
+                         [&](const std::shared_ptr<Statement>& stmt) { return stmt != nullptr && isDead(*stmt); }),
+        statements.end());
+
+    bool changed = statements.size() != before;
+    for (auto& stmt : statements) {
+        if (stmt != nullptr) {
+            changed |= eliminateDeadCode(*stmt);
+        }
+    }
+    return changed;
+}
+
+auto Optimizer::eliminateDeadCode(Statement& stmt) -> bool
+{
+    return std::visit(overloaded {
+                          [&](Block& b) { return eliminateDeadCode(b.statements); },
+                          [&](IfStatement& i) {
+                              bool changed = eliminateDeadCode(*i.ifBlock);
+                              if (i.elseBlock != nullptr) {
+                                  changed |= eliminateDeadCode(*i.elseBlock);
+                              }
+                              return changed;
+                          },
+                          [&](While& w) { return eliminateDeadCode(*w.body); },
+                          [&](auto&) { return false; } },
+        stmt.content);
+}
+
+auto Optimizer::isDead(const Statement& stmt) const -> bool
+{
+    if (const auto* js = std::get_if<JJStatement>(&stmt.content)) {
+        const auto& declaration = declarations[definitions.at(&stmt)];
+        return declaration.reads == 0 && declaration.writes == 0 && isPure(*js->value);
+    }
+    if (const auto* es = std::get_if<ExprStatement>(&stmt.content)) {
+        // A store to a variable nobody reads
+        if (const auto* a = std::get_if<Assign>(&es->expression->content)) {
+            auto it = references.find(es->expression.get());
+            return it != references.end() && declarations[it->second].reads == 0 && isPure(*a->value);
+        }
+        return isPure(*es->expression);
+    }
+    return false;
+}
+
+auto Optimizer::isPure(const Expr& expr) const -> bool
+{
+    // Removing an operator that can throw would also remove its runtime error
+    return std::visit(overloaded {
+                          [&](const Literal&) { return true; },
+                          [&](const Variable&) { return true; },
+                          [&](const Assign&) { return false; },
+                          [&](const Binary& b) {
+                              return LoopInvariants::cannotThrow(expr) && isPure(*b.left) && isPure(*b.right);
+                          },
+                          [&](const Logical& l) { return isPure(*l.left) && isPure(*l.right); },
+                          [&](const Unary& u) { return LoopInvariants::cannotThrow(expr) && isPure(*u.value); },
+                          [&](const Grouping& g) { return isPure(*g.expression); },
+                          [&](const Ternary& t) { return isPure(*t.condition) && isPure(*t.left) && isPure(*t.right); },
+                          [&](const Call& c) {
+                              if (!LoopInvariants::isPureCall(c) || !LoopInvariants::cannotThrow(expr)) {
+                                  return false;
+                              }
+                              return std::all_of(c.args.begin(), c.args.end(), [&](const auto& arg) { return isPure(*arg); });
+                          } },
+        expr.content);
+}
+
+auto Optimizer::numberValues(std::vector<std::shared_ptr<Statement>>& statements) -> void
+{
+    std::unordered_map<std::string, Candidate> candidates;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        if (statements[i] != nullptr) {
+            countValues(*statements[i], i, candidates);
+        }
+    }
+
+    std::vector<std::pair<size_t, std::shared_ptr<Statement>>> temps;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        if (statements[i] != nullptr) {
+            replaceValues(*statements[i], i, candidates, temps);
+        }
+    }
+
+    // A counted loop only gets a primitive counter while its declaration comes right before it; value keys never name a
+    // variable that is written, so temps can go ahead of the declaration
+    for (auto& [index, temp] : temps) {
+        const auto* loop = index > 0 && statements[index] != nullptr ? std::get_if<While>(&statements[index]->content) : nullptr;
+        const auto* counter = loop != nullptr && loop->counted && statements[index - 1] != nullptr
+            ? std::get_if<JJStatement>(&statements[index - 1]->content)
+            : nullptr;
+        if (counter != nullptr && declarations[definitions.at(statements[index - 1].get())].writes != 0) {
+            --index;
+        }
+    }
+
+    // Insert back to front so earlier indices stay valid
+    std::stable_sort(temps.begin(), temps.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (auto& [index, temp] : temps) {
+        statements.insert(statements.begin() + static_cast<std::ptrdiff_t>(index), temp);
+    }
+
+    for (auto& stmt : statements) {
+        if (stmt != nullptr) {
+            numberNested(*stmt);
+        }
+    }
+}
+
+auto Optimizer::numberNested(Statement& stmt) -> void
+{
+    std::visit(overloaded {
+                   [&](Block& b) { numberValues(b.statements); },
+                   [&](IfStatement& i) {
+                       numberNested(*i.ifBlock);
+                       if (i.elseBlock != nullptr) {
+                           numberNested(*i.elseBlock);
+                       }
+                   },
+                   [&](While& w) { numberNested(*w.body); },
+                   [&](auto&) {} },
+        stmt.content);
+}
+
+auto Optimizer::countValues(const Statement& stmt, const size_t index, std::unordered_map<std::string, Candidate>& candidates) -> void
+{
+    // Only expressions this statement always evaluates; nested blocks are numbered on their own
+    std::visit(overloaded {
+                   [&](const ExprStatement& es) { countValues(es.expression, index, candidates); },
+                   [&](const PrintStatement& ps) { countValues(ps.expression, index, candidates); },
+                   [&](const JJStatement& js) { countValues(js.value, index, candidates); },
+                   [&](const IfStatement& i) { countValues(i.condition, index, candidates); },
+                   [&](const While& w) { countValues(w.condition, index, candidates); },
+                   [&](const auto&) {} },
+        stmt.content);
+}
+
+auto Optimizer::countValues(const std::shared_ptr<Expr>& expr, const size_t index, std::unordered_map<std::string, Candidate>& candidates) -> void
+{
+    if (isCandidate(*expr)) {
+        if (auto key = valueKey(*expr)) {
+            auto& candidate = candidates[*key];
+            if (candidate.count++ == 0) {
+                candidate.first = index;
+            }
+        }
+    }
+
+    std::visit(overloaded {
+                   [&](const Binary& b) {
+                       countValues(b.left, index, candidates);
+                       countValues(b.right, index, candidates);
+                   },
+                   [&](const Unary& u) { countValues(u.value, index, candidates); },
+                   [&](const Grouping& g) { countValues(g.expression, index, candidates); },
+                   [&](const Assign& a) { countValues(a.value, index, candidates); },
+                   [&](const Logical& l) { countValues(l.left, index, candidates); },
+                   [&](const Ternary& t) { countValues(t.condition, index, candidates); },
+                   [&](const Call& c) {
+                       for (size_t i = 2; i < c.args.size(); ++i) {
+                           countValues(c.args[i], index, candidates);
+                       }
+                   },
+                   [&](const auto&) {} },
+        expr->content);
+}
+
+auto Optimizer::replaceValues(Statement& stmt, const size_t index, std::unordered_map<std::string, Candidate>& candidates,
+    std::vector<std::pair<size_t, std::shared_ptr<Statement>>>& temps) -> void
+{
+    std::visit(overloaded {
+                   [&](ExprStatement& es) { replaceValues(es.expression, index, candidates, temps); },
+                   [&](PrintStatement& ps) { replaceValues(ps.expression, index, candidates, temps); },
+                   [&](JJStatement& js) { replaceValues(js.value, index, candidates, temps); },
+                   [&](Block& b) {
+                       for (auto& s : b.statements) {
+                           if (s != nullptr) {
+                               replaceValues(*s, index, candidates, temps);
+                           }
+                       }
+                   },
+                   [&](IfStatement& i) {
+                       replaceValues(i.condition, index, candidates, temps);
+                       replaceValues(*i.ifBlock, index, candidates, temps);
+                       if (i.elseBlock != nullptr) {
+                           replaceValues(*i.elseBlock, index, candidates, temps);
+                       }
+                   },
+                   [&](While& w) {
+                       replaceValues(w.condition, index, candidates, temps);
+                       replaceValues(*w.body, index, candidates, temps);
+                   },
+                   [&](Function&) {},
+                   [&](Import&) {} },
+        stmt.content);
+}
+
+auto Optimizer::replaceValues(std::shared_ptr<Expr>& expr, const size_t index, std::unordered_map<std::string, Candidate>& candidates,
+    std::vector<std::pair<size_t, std::shared_ptr<Statement>>>& temps) -> void
+{
+    if (isCandidate(*expr)) {
+        if (auto key = valueKey(*expr)) {
+            auto it = candidates.find(*key);
+            if (it != candidates.end() && it->second.count >= 2 && it->second.first <= index) {
+                auto& candidate = it->second;
+                if (!candidate.temporary) {
+                    const size_t id = declarations.size();
+                    declarations.push_back({ "$v" + std::to_string(temporaries++), 0 });
+                    candidate.temporary = id;
+                    auto temp = std::make_shared<Statement>(JJStatement { Token { TokenType::IDENTIFIER, declarations[id].name, nullptr, 0 }, expr });
+                    definitions[temp.get()] = id;
+                    temps.emplace_back(candidate.first, temp);
+                }
+                expr = makeVariable(*candidate.temporary);
+                return;
+            }
+        }
+    }
+
+    std::visit(overloaded {
+                   [&](Assign& a) { replaceValues(a.value, index, candidates, temps); },
+                   [&](Binary& b) {
+                       replaceValues(b.left, index, candidates, temps);
+                       replaceValues(b.right, index, candidates, temps);
+                   },
+                   [&](Logical& l) {
+                       replaceValues(l.left, index, candidates, temps);
+                       replaceValues(l.right, index, candidates, temps);
+                   },
+                   [&](Unary& u) { replaceValues(u.value, index, candidates, temps); },
+                   [&](Grouping& g) { replaceValues(g.expression, index, candidates, temps); },
+                   [&](Ternary& t) {
+                       replaceValues(t.condition, index, candidates, temps);
+                       replaceValues(t.left, index, candidates, temps);
+                       replaceValues(t.right, index, candidates, temps);
+                   },
+                   [&](Call& c) {
+                       for (size_t i = 2; i < c.args.size(); ++i) {
+                           replaceValues(c.args[i], index, candidates, temps);
+                       }
+                   },
+                   [&](auto&) {} },
+        expr->content);
+}
+
+auto Optimizer::valueKey(const Expr& expr) const -> std::optional<std::string>
+{
+    return std::visit(overloaded {
+                          [&](const Literal& l) -> std::optional<std::string> {
+                              return std::visit(overloaded {
+                                                    [](const double d) { return "D" + doubleText(d); },
+                                                    [](const std::string& s) { return "S" + s; },
+                                                    [](const bool b) { return std::string(b ? "T" : "F"); },
+                                                    [](const nullptr_t) { return std::string("N"); } },
+                                  l.literal);
+                          },
+                          [&](const Variable&) -> std::optional<std::string> {
+                              // Only variables that are never reassigned hold a single value
+                              auto it = references.find(&expr);
+                              if (it == references.end() || declarations[it->second].writes != 0) {
+                                  return std::nullopt;
+                              }
+                              return "#" + std::to_string(it->second);
+                          },
+                          [&](const Grouping& g) { return valueKey(*g.expression); },
+                          [&](const Unary& u) -> std::optional<std::string> {
+                              auto value = valueKey(*u.value);
+                              if (!value) {
+                                  return std::nullopt;
+                              }
+                              return "(" + u.opr.getLexeme() + " " + *value + ")";
+                          },
+                          [&](const Binary& b) -> std::optional<std::string> {
+                              auto left = valueKey(*b.left);
+                              auto right = left ? valueKey(*b.right) : std::nullopt;
+                              if (!right) {
+                                  return std::nullopt;
+                              }
+                              return "(" + b.opr.getLexeme() + " " + *left + " " + *right + ")";
+                          },
+                          [&](const Logical& l) -> std::optional<std::string> {
+                              auto left = valueKey(*l.left);
+                              auto right = left ? valueKey(*l.right) : std::nullopt;
+                              if (!right) {
+                                  return std::nullopt;
+                              }
+                              return "(" + l.token.getLexeme() + " " + *left + " " + *right + ")";
+                          },
+                          [&](const Ternary& t) -> std::optional<std::string> {
+                              auto condition = valueKey(*t.condition);
+                              auto left = condition ? valueKey(*t.left) : std::nullopt;
+                              auto right = left ? valueKey(*t.right) : std::nullopt;
+                              if (!right) {
+                                  return std::nullopt;
+                              }
+                              return "(? " + *condition + " " + *left + " " + *right + ")";
+                          },
+                          [&](const Call& c) -> std::optional<std::string> {
+                              if (!LoopInvariants::isPureCall(c)) {
+                                  return std::nullopt;
+                              }
+                              std::string key = "(call";
+                              for (const auto& arg : c.args) {
+                                  auto value = valueKey(*arg);
+                                  if (!value) {
+                                      return std::nullopt;
+                                  }
+                                  key += " " + *value;
+                              }
+                              return key + ")";
+                          },
+                          [&](const Assign&) -> std::optional<std::string> { return std::nullopt; } },
+        expr.content);
+}
+
+auto Optimizer::isTrivial(const Expr& expr) -> bool
+{
+    if (const auto* g = std::get_if<Grouping>(&expr.content)) {
+        return isTrivial(*g->expression);
+    }
+    return std::holds_alternative<Literal>(expr.content) || std::holds_alternative<Variable>(expr.content);
+}
+
+auto Optimizer::isCandidate(const Expr& expr) -> bool
+{
+    // A grouping shares its key with the expression inside, which is counted on its own
+    if (isTrivial(expr) || std::holds_alternative<Grouping>(expr.content)) {
+        return false;
+    }
+    // Comparisons and ! produce a raw boolean that branches consume directly; a temporary would have to box it
+    if (const auto* u = std::get_if<Unary>(&expr.content)) {
+        return u->opr.type != TokenType::BANG;
+    }
+    if (const auto* b = std::get_if<Binary>(&expr.content)) {
+        switch (b->opr.type) {
+        case TokenType::EQUAL_EQUAL:
+        case TokenType::BANG_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+            return false;
+        default:
+            return true;
+        }
+    }
+    return true;
+}
+
+auto Optimizer::makeVariable(const size_t declaration) -> std::shared_ptr<Expr>
+{
+    const auto& target = declarations[declaration];
+    auto variable = std::make_shared<Expr>(ExprType::VARIABLE, Variable { Token { TokenType::IDENTIFIER, target.name, nullptr, target.line } });
+    references[variable.get()] = declaration;
+    return variable;
+}
@@ -10,11 +10,28 @@ std::vector<std::shared_ptr<Statement>> Parser::parse()
 {
     std::vector<std::shared_ptr<Statement>> statements;
     while (!isAtEnd()) {
+        // Imports are only meaningful at the top level of a module
+        if (match({ TokenType::IMPORT })) {
+            statements.push_back(importDeclaration());
+            continue;
+        }
         statements.push_back(declaration());
     }
     return statements;
 }
 
+std::shared_ptr<Statement> Parser::importDeclaration()
+{
+    try {
+        auto module = consume(TokenType::IDENTIFIER, "Expect module name after 'import'.");
+        consume(TokenType::SEMICOLON, "Expect ';' after module name.");
+        return std::make_shared<Statement>(Statement { Import { module } });
+    } catch (ParseError& error) {
+        synchronize();
+        return nullptr;
+    }
+}
+
 std::shared_ptr<Statement> Parser::blockStatement()
 {
     std::vector<std::shared_ptr<Statement>> statements;
@@ -72,9 +89,10 @@ std::shared_ptr<Statement> Parser::jjdeclaration()
 
 std::shared_ptr<Statement> Parser::expressionStatement()
 {
+    const int line = peek().line;
     auto expr = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-    return std::make_shared<Statement>(Statement { ExprStatement { expr } });
+    return std::make_shared<Statement>(Statement { ExprStatement { expr, line } });
 }
 
 std::shared_ptr<Expr> Parser::assignment()
@@ -100,6 +118,8 @@ std::shared_ptr<Statement> Parser::statement()
 {
     if (match({ TokenType::WHILE }))
         return whileStatement();
+    if (match({ TokenType::FOR }))
+        return forStatement();
     if (match({ TokenType::LOG }))
         return printStatement();
     if (match({ TokenType::LEFT_BRACE }))
@@ -111,16 +131,56 @@ std::shared_ptr<Statement> Parser::statement()
 
 std::shared_ptr<Statement> Parser::whileStatement()
 {
+    const int line = previous().line;
     consume(TokenType::LEFT_PAREN, "Expect '(' after while");
     auto condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after expression");
     auto body = statement();
-    return std::make_shared<Statement>(While { condition, body });
+    While loop { condition, body };
+    loop.line = line;
+    return std::make_shared<Statement>(std::move(loop));
+}
+
+std::shared_ptr<Statement> Parser::forStatement()
+{
+    const int line = previous().line;
+    consume(TokenType::LEFT_PAREN, "Expect '(' after for");
+    std::shared_ptr<Statement> initializer;
+    if (match({ TokenType::JJ })) {
+        initializer = jjdeclaration();
+    } else if (!match({ TokenType::SEMICOLON })) {
+        initializer = expressionStatement();
+    }
+
+    auto condition = check(TokenType::SEMICOLON) ? std::make_shared<Expr>(ExprType::LITERAL, Literal { true }) : expression();
+    consume(TokenType::SEMICOLON, "Expect ';' after loop condition");
+    std::shared_ptr<Expr> increment;
+    if (!check(TokenType::RIGHT_PAREN)) {
+        increment = expression();
+    }
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses");
+    auto body = statement();
+
+    // { initializer; while (condition) { body; increment; } }
+    std::vector<std::shared_ptr<Statement>> iteration { body };
+    if (increment != nullptr) {
+        iteration.push_back(std::make_shared<Statement>(Statement { ExprStatement { increment, line } }));
+    }
+    While loop { condition, std::make_shared<Statement>(Statement { Block { iteration } }) };
+    loop.counted = true;
+    loop.line = line;
+    std::vector<std::shared_ptr<Statement>> statements;
+    if (initializer != nullptr) {
+        statements.push_back(initializer);
+    }
+    statements.push_back(std::make_shared<Statement>(std::move(loop)));
+    return std::make_shared<Statement>(Statement { Block { statements } });
 }
 
 /* Returns null for else block if else block does not exist */
 std::shared_ptr<Statement> Parser::ifStatement()
 {
+    const int line = previous().line;
     const auto expr = expression();
     std::shared_ptr<Statement> ifBlock = nullptr;
     std::shared_ptr<Statement> elseBlock = nullptr;
@@ -136,14 +196,15 @@ std::shared_ptr<Statement> Parser::ifStatement()
             throw ParseError { peek(), "Expected { but recieved " };
         }
     }
-    return std::make_shared<Statement>(IfStatement { expr, ifBlock, elseBlock });
+    return std::make_shared<Statement>(IfStatement { expr, ifBlock, elseBlock, line });
 }
 
 std::shared_ptr<Statement> Parser::printStatement()
 {
+    const int line = previous().line;
     const auto value = expression();
     consume(TokenType::SEMICOLON, "Expect ';' after value.");
-    auto stmt = std::make_shared<Statement>(Statement { PrintStatement { value } });
+    auto stmt = std::make_shared<Statement>(Statement { PrintStatement { value, line } });
     return stmt;
 }
 
@@ -304,9 +365,9 @@ std::shared_ptr<Expr> Parser::primary()
     if (match({ TokenType::IDENTIFIER }))
         return std::make_shared<Expr>(ExprType::VARIABLE, Variable { previous() });
     if (match({ TokenType::FALSE }))
-        return std::make_shared<Expr>(ExprType::LITERAL, Literal { true });
-    if (match({ TokenType::TRUE }))
         return std::make_shared<Expr>(ExprType::LITERAL, Literal { false });
+    if (match({ TokenType::TRUE }))
+        return std::make_shared<Expr>(ExprType::LITERAL, Literal { true });
     if (match({ TokenType::NIL }))
         return std::make_shared<Expr>(ExprType::LITERAL, Literal { nullptr });
     if (match({ TokenType::NUMBER }))
@@ -392,6 +453,7 @@ void Parser::synchronize()
         case TokenType::WHILE:
         case TokenType::LOG:
         case TokenType::RETURN:
+        case TokenType::IMPORT:
             return;
         }
 
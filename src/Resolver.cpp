@@ -0,0 +1,182 @@
+#include "Resolver.h"
+#include "LoopInvariants.h"
+#include "Statement.h"
+#include "statementTypes.h"
+#include <algorithm>
+#include <stdexcept>
+
+template <class... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+
+template <class... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+void Resolver::resolve(std::vector<std::shared_ptr<Statement>>& program)
+{
+    locals.clear();
+    scopes.clear();
+    claimed.clear();
+    imported.clear();
+    nextSlot = 0;
+    maxLocals = 0;
+
+    beginScope();
+    for (auto& stmt : program) {
+        if (stmt != nullptr) {
+            resolve(*stmt);
+        }
+    }
+    endScope();
+}
+
+void Resolver::resolve(Statement& stmt)
+{
+    std::visit(overloaded {
+                   [&](ExprStatement& es) { resolve(*es.expression); },
+                   [&](PrintStatement& ps) { resolve(*ps.expression); },
+                   [&](JJStatement& js) {
+                       // The initializer is evaluated before the name is in scope
+                       resolve(*js.value);
+                       js.slot = declare(js.name.getLexeme());
+                       if (js.slot < 0) {
+                           js.module = module;
+                       }
+                   },
+                   [&](Block& b) {
+                       beginScope();
+                       for (auto& s : b.statements) {
+                           if (s != nullptr) {
+                               resolve(*s);
+                           }
+                       }
+                       endScope();
+                   },
+                   [&](IfStatement& i) {
+                       resolve(*i.condition);
+                       resolve(*i.ifBlock);
+                       if (i.elseBlock != nullptr) {
+                           resolve(*i.elseBlock);
+                       }
+                   },
+                   [&](While& w) {
+                       // Hoisted temporaries live for the whole loop and are released after it
+                       beginScope();
+                       if (w.counted) {
+                           // An int or long counter; a long takes two slots
+                           w.counterSlot = allocate();
+                           allocate();
+                       }
+                       w.invariants.clear();
+                       for (const auto& expr : LoopInvariants::find(w)) {
+                           if (claimed.insert(expr.get()).second) {
+                               w.invariants.push_back({ expr, allocate() });
+                           }
+                       }
+                       resolve(*w.condition);
+                       resolve(*w.body);
+                       for (const auto& hoisted : w.invariants) {
+                           claimed.erase(hoisted.expression.get());
+                       }
+                       endScope();
+                   },
+                   [&](Function&) {},
+                   [&](Import& i) {
+                       const auto name = i.module.getLexeme();
+                       if (exports == nullptr || exports->find(name) == exports->end()) {
+                           throw std::runtime_error("Unknown module " + name);
+                       }
+                       imported.push_back(name);
+                   } },
+        stmt.content);
+}
+
+void Resolver::resolve(Expr& expr)
+{
+    std::visit(overloaded {
+                   [&](Variable& v) { lookup(v.name.getLexeme(), v.slot, v.module); },
+                   [&](Assign& a) {
+                       resolve(*a.value);
+                       if (!lookup(a.name.getLexeme(), a.slot, a.module)) {
+                           throw std::runtime_error("Cannot assign " + a.name.getLexeme() + ": variable does not exist");
+                       }
+                   },
+                   [&](Binary& b) {
+                       resolve(*b.left);
+                       resolve(*b.right);
+                   },
+                   [&](Logical& l) {
+                       resolve(*l.left);
+                       resolve(*l.right);
+                   },
+                   [&](Unary& u) { resolve(*u.value); },
+                   [&](Grouping& g) { resolve(*g.expression); },
+                   [&](Ternary& t) {
+                       resolve(*t.condition);
+                       resolve(*t.left);
+                       resolve(*t.right);
+                   },
+                   [&](Call& c) {
+                       // The callee names a builtin, not a variable
+                       for (auto& arg : c.args) {
+                           resolve(*arg);
+                       }
+                   },
+                   [&](Literal&) {} },
+        expr.content);
+}
+
+void Resolver::beginScope()
+{
+    scopes.emplace_back(locals.size(), nextSlot);
+}
+
+void Resolver::endScope()
+{
+    const auto [start, slot] = scopes.back();
+    scopes.pop_back();
+    locals.resize(start);
+    nextSlot = slot;
+}
+
+int Resolver::declare(const std::string& name)
+{
+    for (size_t i = scopes.back().first; i < locals.size(); ++i) {
+        if (locals[i].name == name) {
+            throw std::runtime_error("Cannot redefine " + name);
+        }
+    }
+    // Top-level variables of an imported module are shared with its importers; optimizer temporaries are not
+    const bool shared = exportsGlobals && scopes.size() == 1 && name.front() != '$';
+    const int slot = shared ? -1 : allocate();
+    locals.push_back({ name, slot });
+    return slot;
+}
+
+int Resolver::allocate()
+{
+    const int slot = nextSlot++;
+    maxLocals = std::max(maxLocals, static_cast<size_t>(nextSlot));
+    return slot;
+}
+
+bool Resolver::lookup(const std::string& name, int& slot, std::string& owner) const
+{
+    for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
+        if (it->name == name) {
+            slot = it->slot;
+            owner = it->slot < 0 ? module : "";
+            return true;
+        }
+    }
+    // Later imports shadow earlier ones
+    for (auto it = imported.rbegin(); it != imported.rend(); ++it) {
+        if (exports->at(*it).count(name) != 0) {
+            slot = -1;
+            owner = *it;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,6 +1,26 @@
 #include "Scanner.h"
 #include "Token.h"
 
+const std::unordered_map<std::string, TokenType> Scanner::keywords{
+    {"and", TokenType::AND},
+    {"class", TokenType::CLASS},
+    {"else", TokenType::ELSE},
+    {"false", TokenType::FALSE},
+    {"for", TokenType::FOR},
+    {"func", TokenType::FUNC},
+    {"if", TokenType::IF},
+    {"nil", TokenType::NIL},
+    {"or", TokenType::OR},
+    {"log", TokenType::LOG},
+    {"return", TokenType::RETURN},
+    {"super", TokenType::SUPER},
+    {"this", TokenType::THIS},
+    {"true", TokenType::TRUE},
+    {"jj", TokenType::JJ},
+    {"while", TokenType::WHILE},
+    {"import", TokenType::IMPORT},
+};
+
 char Scanner::peek() {
     if (isAtEnd())
         return '\0';
@@ -40,7 +60,7 @@ void Scanner::number() {
             advance();
     }
 
-    double output = stod(source.substr(start, current));
+    double output = stod(source.substr(start, current - start));
     addToken(TokenType::NUMBER, output);
 }
 
@@ -177,12 +197,10 @@ void Scanner::scanToken() {
                     advance();
                 TokenType type = TokenType::IDENTIFIER;
                 std::string output = source.substr(start, current - start);
-                try {
-                    type = keywords.at(output);
-                    addToken(type);
-                } catch (const std::out_of_range &e) {
-                    addToken(type);
+                if (const auto keyword = keywords.find(output); keyword != keywords.end()) {
+                    type = keyword->second;
                 }
+                addToken(type);
             } else {
                 err.handlerError(line, "Unexpected character.");
             }
@@ -0,0 +1,35 @@
+#include "StringArena.h"
+#include <algorithm>
+
+auto StringArena::allocate(const size_t length) -> StringObject*
+{
+    // Keep every header aligned for the size_t it starts with
+    const size_t size = (sizeof(StringObject) + length + alignof(StringObject) - 1) & ~(alignof(StringObject) - 1);
+    if (size > left) {
+        const size_t block = std::max(blockSize, size);
+        blocks.push_back(std::make_unique<char[]>(block));
+        next = blocks.back().get();
+        left = block;
+    }
+    auto* object = reinterpret_cast<StringObject*>(next);
+    object->length = length;
+    next += size;
+    left -= size;
+    return object;
+}
+
+auto StringArena::make(const std::string_view text) -> const StringObject*
+{
+    StringObject* object = allocate(text.size());
+    std::memcpy(const_cast<char*>(object->data()), text.data(), text.size());
+    return object;
+}
+
+auto StringArena::concat(const std::string_view left, const std::string_view right) -> const StringObject*
+{
+    StringObject* object = allocate(left.size() + right.size());
+    auto* data = const_cast<char*>(object->data());
+    std::memcpy(data, left.data(), left.size());
+    std::memcpy(data + left.size(), right.data(), right.size());
+    return object;
+}
@@ -0,0 +1,78 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t workers)
+{
+    if (workers == 0) {
+        workers = 1;
+    }
+    threads.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && active == 0; });
+    if (error) {
+        auto rethrow = error;
+        error = nullptr;
+        std::rethrow_exception(rethrow);
+    }
+}
+
+void ThreadPool::work()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            active++;
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+            if (tasks.empty() && active == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
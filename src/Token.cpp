@@ -87,6 +87,8 @@ std::string Token::typeToString() const {
             return "JJ";
         case TokenType::WHILE:
             return "WHILE";
+        case TokenType::IMPORT:
+            return "IMPORT";
         case TokenType::ENDOFFILE:
             return "ENDOFFILE";
         case TokenType::QUESTION_MARK:
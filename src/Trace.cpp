@@ -0,0 +1,140 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+Trace::Span::Span(Trace& trace, std::string name, std::string detail)
+    : trace(trace)
+{
+    if (trace.enabled()) {
+        this->name = std::move(name);
+        this->detail = std::move(detail);
+        start = Clock::now();
+    }
+}
+
+Trace::Span::~Span()
+{
+    if (trace.enabled()) {
+        trace.record(name, detail, start, Clock::now());
+    }
+}
+
+Trace::Trace(bool enabled, bool statements)
+    : on(enabled)
+    , perStatement(enabled && statements)
+    , origin(Clock::now())
+{
+}
+
+void Trace::record(const std::string& name, const std::string& detail, Clock::time_point start, Clock::time_point end,
+    const std::string& lane)
+{
+    if (!on) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index;
+    if (lane.empty()) {
+        const auto id = std::this_thread::get_id();
+        auto it = threadLanes.find(id);
+        if (it == threadLanes.end()) {
+            it = threadLanes.emplace(id, laneNames.size()).first;
+            laneNames.push_back("thread " + std::to_string(threadLanes.size()));
+        }
+        index = it->second;
+    } else {
+        auto it = lanes.find(lane);
+        if (it == lanes.end()) {
+            it = lanes.emplace(lane, laneNames.size()).first;
+            laneNames.push_back(lane);
+        }
+        index = it->second;
+    }
+    events.push_back({ name, detail, start, end, index });
+}
+
+auto Trace::report() const -> std::string
+{
+    struct Phase {
+        size_t count = 0;
+        Clock::duration total {};
+        Clock::duration longest {};
+        Clock::time_point first = Clock::time_point::max();
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, Phase> phases;
+    Clock::time_point last = origin;
+    for (const auto& event : events) {
+        Phase& phase = phases[event.name];
+        phase.count++;
+        phase.total += event.end - event.start;
+        phase.longest = std::max(phase.longest, event.end - event.start);
+        phase.first = std::min(phase.first, event.start);
+        last = std::max(last, event.end);
+    }
+
+    // Listed in the order the phases first ran
+    std::vector<std::pair<std::string, Phase>> ordered(phases.begin(), phases.end());
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second.first < b.second.first; });
+
+    const auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    const double wall = ms(last - origin);
+
+    std::string out;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-16s %8s %12s %12s %8s\n", "phase", "spans", "total ms", "max ms", "% wall");
+    out += line;
+    for (const auto& [name, phase] : ordered) {
+        std::snprintf(line, sizeof(line), "%-16s %8zu %12.3f %12.3f %7.1f%%\n", name.c_str(), phase.count,
+            ms(phase.total), ms(phase.longest), wall > 0 ? 100.0 * ms(phase.total) / wall : 0.0);
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%-16s %8s %12.3f\n", "wall", "", wall);
+    out += line;
+    return out;
+}
+
+/* The minimal JSON string escaping the names in a trace need */
+static std::string quote(const std::string& text)
+{
+    std::string out = "\"";
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void Trace::writeChromeTrace(const std::filesystem::path& file) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream out { file };
+    const auto us = [this](Clock::time_point t) { return std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count(); };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < laneNames.size(); ++i) {
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":" << quote(laneNames[i]) << "}},\n";
+    }
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& event = events[i];
+        out << "{\"name\":" << quote(event.detail.empty() ? event.name : event.name + " " + event.detail)
+            << ",\"cat\":" << quote(event.name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.lane
+            << ",\"ts\":" << us(event.start) << ",\"dur\":" << us(event.end) - us(event.start) << "}"
+            << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    if (!out) {
+        throw std::runtime_error("Failed to write trace to " + file.string());
+    }
+}
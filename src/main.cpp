@@ -1,78 +1,70 @@
-#include "Compiler.h"
-#include "Linker.h"
-#include "Parser.h"
-#include "Scanner.h"
+#include "Benchmark.h"
+#include "Daemon.h"
+#include "Driver.h"
 #include <cstdlib>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
-const std::string NATIVEIMAGEPATH = "/Users/jamie/Library/Java/JavaVirtualMachines/graalvm-jdk-22.0.1+8.1/Contents/Home/bin/native-image";
-
-void runfile(const std::string& path)
+int main(const int argc, char* argv[])
 {
-    if (!std::filesystem::path(path).has_extension() || std::filesystem::path(path).extension() != ".jay") {
-        std::cerr << "Error: Only .jay files are supported." << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    std::ifstream ifs { path };
-    if (!ifs) {
-        std::cerr << "Failed to open input file: " << path << '\n';
-        exit(EXIT_FAILURE);
+    bool daemon = false;
+    bool connect = false;
+    bool bench = false;
+    size_t benchMax = 4 << 20;
+    std::filesystem::path socketPath;
+    size_t workers = std::thread::hardware_concurrency();
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--daemon") {
+            daemon = true;
+        } else if (arg == "--connect") {
+            connect = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--bench-max" && i + 1 < argc) {
+            benchMax = Benchmark::parseSize(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
     }
 
-    std::string baseName = std::filesystem::path(path).stem().string();
-    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-    Scanner scanner { data };
-    std::vector<Token> output = scanner.scanTokens();
-
-    Parser parser { output };
-    auto parse = parser.parse();
-    Compiler compiler {};
-    AssemblyInfo assem = {};
-    Linker linker { baseName };
-    for (auto& stmt : parse) {
-        linker.addCode(compiler.generateAssembly(*stmt).code);
+    try {
+        if (bench && benchMax > 0) {
+            return Benchmark::run(args, benchMax, std::cout);
+        }
+        if (socketPath.empty() && (daemon || connect)) {
+            socketPath = Daemon::defaultSocket();
+        }
+        if (daemon && args.empty()) {
+            Daemon server { socketPath, workers, argv[0] };
+            server.serve();
+        }
+        if (connect && !daemon) {
+            return Daemon::request(socketPath, args);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
     }
 
-    compiler.generateLocalVariables(assem, compiler.environment);
-    linker.addCode(assem.code);
-
-    std::string outputDir = baseName;
-    std::filesystem::create_directories(outputDir + "/src");
-    std::filesystem::create_directories(outputDir + "/bin");
-
-    std::string asmFileName = outputDir + "/src/" + baseName + ".j";
-    std::string classFileName = outputDir + "/src/" + baseName + ".class";
-    std::string executableName = outputDir + "/bin/" + baseName;
-
-    linker.writeToFile(asmFileName);
-    std::string compileCommand = "../libs/Krakatau/target/release/krak2 asm --out " + outputDir + "/src " + asmFileName;
-    if (system(compileCommand.c_str()) != 0) {
-        std::cerr << "Compilation failed.\n";
-        return;
-    }
-
-    std::string nativeImageCommand = NATIVEIMAGEPATH + " -H:+UnlockExperimentalVMOptions" + " -H:ReflectionConfigurationFiles=" + outputDir + "/META-INF/native-image/reflect-config.json" + " -H:ResourceConfigurationFiles=" + outputDir + "/META-INF/native-image/resource-config.json" + " -H:SerializationConfigurationFiles=" + outputDir + "/META-INF/native-image/serialization-config.json" + " -cp ../jaylib/target/JayLib-0.1.jar:" + outputDir + "/src" + " " + baseName + " -H:Name=" + executableName + " --no-fallback";
-    if (system(nativeImageCommand.c_str()) != 0) {
-        std::cerr << "Native image generation failed.\n";
-        return;
-    } else {
-        system(executableName.c_str());
-    }
-
-    delete compiler.environment;
-    exit(EXIT_SUCCESS);
-}
-
-int main(const int argc, char* argv[])
-{
-    if (argc != 2) {
-        std::cout << "Usage: jj [script.jay]" << std::endl;
+    Options options {};
+    if (daemon || bench || !Options::parse(args, options)) {
+        std::cout << "Usage: jj [-O0|-O1|-O2] [--no-cache] [--jvm|--interp] [--profile] [--time-report] [--trace file.json [--trace-statements]] [--mem-report] [--parallel-codegen] [--connect] [--socket path] [script.jay...]\n"
+                  << "       jj --daemon [--workers n] [--socket path]\n"
+                  << "       jj --bench [--bench-max size] [straight|nested|blocks|interop...]" << std::endl;
         exit(EXIT_FAILURE);
     }
-    runfile(argv[1]);
+    options.workingDirectory = std::filesystem::current_path();
+
+    Driver driver { argv[0] };
+    return driver.run(options, {});
 }
@@ -0,0 +1,77 @@
+#!/bin/sh
+# Runs every tests/*.jay at -O0, -O1 and -O2 on each backend and compares its stdout with the .expected file beside
+# it. A script whose first line is "// expect: error" must also exit with a failure status.
+#
+# Usage: tests/run.sh path/to/jj [--interp] [--jvm] [native]    (--interp and --jvm when none is given)
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 path/to/jj [--interp] [--jvm] [native]" >&2
+    exit 2
+fi
+
+jj=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+shift
+backends=${*:-"--interp --jvm"}
+tests=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$tests/.." && pwd)
+
+# jj finds Krakatau and JayLib relative to its working directory, so builds happen one level below the repository;
+# the build cache is kept apart from the user's
+work=$(mktemp -d "$root/test-output.XXXXXX")
+trap 'rm -rf "$work"' EXIT
+export JAY_CACHE_DIR="$work/cache"
+
+passed=0
+failed=0
+for script in "$tests"/*.jay; do
+    name=$(basename "$script" .jay)
+    expectError=false
+    head -n 1 "$script" | grep -q '^// expect: error' && expectError=true
+
+    for backend in $backends; do
+        for level in -O0 -O1 -O2; do
+            problem=""
+            if [ "$backend" = native ]; then
+                # jj runs the program itself once it is built; the executable is run again on its own
+                rm -rf "$work/$name"
+                (cd "$work" && "$jj" "$level" "$script") >/dev/null 2>&1
+                if [ -x "$work/$name/bin/$name" ]; then
+                    (cd "$work" && "$name/bin/$name") >"$work/out" 2>"$work/err"
+                    status=$?
+                else
+                    problem="did not build"
+                fi
+            else
+                # The first --jvm run writes the CDS archive, and the JVM may warn about it on stdout; the second
+                # run maps the archive, so its stdout is the program's alone
+                if [ "$backend" = --jvm ]; then
+                    (cd "$work" && "$jj" "$level" "$backend" "$script") >/dev/null 2>&1
+                fi
+                (cd "$work" && "$jj" "$level" "$backend" "$script") >"$work/out" 2>"$work/err"
+                status=$?
+            fi
+
+            if [ -n "$problem" ]; then
+                :
+            elif [ "$expectError" = true ] && [ $status -eq 0 ]; then
+                problem="expected an error, exited with 0"
+            elif [ "$expectError" = false ] && [ $status -ne 0 ]; then
+                problem="exited with $status"
+            elif ! diff -u "$tests/$name.expected" "$work/out" >"$work/diff"; then
+                problem="output differs"
+            fi
+
+            if [ -z "$problem" ]; then
+                passed=$((passed + 1))
+            else
+                failed=$((failed + 1))
+                echo "FAIL $name $backend $level: $problem"
+                cat "$work/diff" "$work/err" 2>/dev/null | sed 's/^/    /'
+            fi
+            rm -f "$work/diff" "$work/err"
+        done
+    done
+done
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]